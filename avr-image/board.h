@@ -0,0 +1,153 @@
+/**************************************************************************
+ *   board.h  --  This file is part of GBCR.                              *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   Netris is free software: you can redistribute it and/or modify       *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   Netris is distributed in the hope that it will be useful,            *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _BOARD_H
+#define _BOARD_H
+
+#include "shift_register.h"
+
+/*
+ * Board profiles
+ *
+ * A board profile describes how the shift registers are wired to the
+ * microcontroller and how they are driven. The profile is selected with
+ * the BOARD variable in the Makefile, e.g.
+ *
+ *     make BOARD=GENERIC
+ *
+ * BOARD_GBCR     -- the GBCR reader board; pins are template parameters such
+ *                   that every pin access compiles to a single instruction
+ * BOARD_GBCR_SPI -- the shift registers are clocked by the hardware SPI unit;
+ *                   this requires a different wiring (see below)
+ * BOARD_GENERIC  -- same wiring as BOARD_GBCR, but using the runtime shift
+ *                   register classes (useful when rewiring a board without
+ *                   touching the code)
+ * BOARD_GBCR_GBA -- BOARD_GBCR extended with the wiring to read GBA
+ *                   cartridges (see below)
+ */
+#if defined(BOARD_GBCR) || defined(BOARD_GENERIC) || defined(BOARD_GBCR_GBA)
+
+// cartridge write and read strobes (PORTB)
+#define GBWR        PINB3
+#define GBRD        PINB4
+
+// address register (2x 74HC595): port, serial, clock, latch
+#define SRO_PORT    B
+#define SRO_SER     PINB1
+#define SRO_CLK     PINB0
+#define SRO_RCK     PINB2
+
+// data register (74HC299): port, S0, S1, DS0, Q7, CP, OE1
+#define SRU_PORT    C
+#define SRU_S0      PINC0
+#define SRU_S1      PINC1
+#define SRU_DS0     PINC2
+#define SRU_Q7      PINC3
+#define SRU_CP      PINC4
+#define SRU_OE1     PINC5
+
+#if defined(BOARD_GBCR_GBA)
+
+// A GBA cartridge multiplexes the lower 16 address bits with the data on
+// AD0-AD15 (the GB address pins) and takes A16-A23 on the GB data pins.
+// The outputs of the address register are tri-stated through their /OE
+// pin, such that the cartridge can drive AD0-AD15, which are read by a
+// second register:
+//
+//     PB5 --> 74HC595 /OE (both; low in GB mode)
+//     PD4 --> 74HC165 PL (both)
+//     PD6 --> 74HC165 CP (both)
+//     PD7 <-- 74HC165 Q7 (AD8-AD15); its DS <-- Q7 of the AD0-AD7 register
+//
+// GBA cartridges run at 3.3 V; the cartridge slot has to be supplied
+// accordingly.
+#define BOARD_HAS_GBA
+
+// address register output enable (PORTB)
+#define GBA_OE      PINB5
+
+// AD input register (2x 74HC165): port, Q7, PL, CP
+#define SRI_PORT    D
+#define SRI_Q7      PIND7
+#define SRI_PL      PIND4
+#define SRI_CP      PIND6
+
+#endif
+
+#elif defined(BOARD_GBCR_SPI)
+
+// The SPI unit owns PB3 (MOSI), PB4 (MISO) and PB5 (SCK), hence the
+// cartridge strobes move to PB0 and PB1:
+//
+//     PB3 (MOSI) --> 74HC595 SER and 74HC299 DS0
+//     PB4 (MISO) <-- 74HC299 Q7
+//     PB5 (SCK)  --> 74HC595 SRCLK and 74HC299 CP
+//     PB2 (SS)   --> 74HC595 RCLK (latch)
+//
+// Both chips share the clock: the 74HC299 ignores it while halted
+// (S0 = S1 = 0) and the 74HC595 only updates its outputs upon a latch.
+
+// cartridge write and read strobes (PORTB)
+#define GBWR        PINB0
+#define GBRD        PINB1
+
+// address register (2x 74HC595): port, latch
+#define SRO_PORT    B
+#define SRO_RCK     PINB2
+
+// data register (74HC299): port, S0, S1, OE1
+#define SRU_PORT    C
+#define SRU_S0      PINC0
+#define SRU_S1      PINC1
+#define SRU_OE1     PINC5
+
+#else
+#error "No board profile selected; define BOARD_GBCR, BOARD_GBCR_SPI, BOARD_GBCR_GBA or BOARD_GENERIC"
+#endif
+
+#define _BOARD_CONCAT(a, b) a##b
+#define BOARD_CONCAT(a, b) _BOARD_CONCAT(a, b)
+
+#if defined(BOARD_GBCR) || defined(BOARD_GBCR_GBA)
+typedef ShiftRegisterSIPOStatic<BOARD_CONCAT(Port, SRO_PORT), SRO_SER, SRO_CLK, SRO_RCK> AddressRegister;
+typedef ShiftRegisterUniversalStatic<BOARD_CONCAT(Port, SRU_PORT), SRU_S0, SRU_S1, SRU_DS0,
+                                     SRU_Q7, SRU_CP, SRU_OE1> DataRegister;
+#define ADDRESS_REGISTER(name) AddressRegister name
+#define DATA_REGISTER(name) DataRegister name
+#elif defined(BOARD_GBCR_SPI)
+typedef ShiftRegisterSIPOSpi<BOARD_CONCAT(Port, SRO_PORT), SRO_RCK> AddressRegister;
+typedef ShiftRegisterUniversalSpi<BOARD_CONCAT(Port, SRU_PORT), SRU_S0, SRU_S1, SRU_OE1> DataRegister;
+#define ADDRESS_REGISTER(name) AddressRegister name
+#define DATA_REGISTER(name) DataRegister name
+#else
+typedef ShiftRegisterSIPO AddressRegister;
+typedef ShiftRegisterUniversal DataRegister;
+#define ADDRESS_REGISTER(name) AddressRegister name(&BOARD_CONCAT(PORT, SRO_PORT), \
+    &BOARD_CONCAT(DDR, SRO_PORT), SRO_SER, SRO_CLK, SRO_RCK)
+#define DATA_REGISTER(name) DataRegister name(&BOARD_CONCAT(PORT, SRU_PORT), \
+    &BOARD_CONCAT(DDR, SRU_PORT), SRU_S0, SRU_S1, SRU_DS0, SRU_Q7, SRU_CP, SRU_OE1)
+#endif
+
+#if defined(BOARD_HAS_GBA)
+typedef ShiftRegisterPISOStatic<BOARD_CONCAT(Port, SRI_PORT), SRI_Q7, SRI_PL, SRI_CP> InputRegister;
+#define INPUT_REGISTER(name) InputRegister name
+#endif
+
+#endif
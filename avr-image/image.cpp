@@ -20,24 +20,80 @@
 
 #include <avr/io.h>
 #include <util/delay.h>
+#include <util/crc16.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
 #include "serial.h"
-#include "shift_register.h"
+#include "board.h"
 
-// serial, clock, latch
-ShiftRegisterSIPO sro(&PORTB, &DDRB, PINB1, PINB0, PINB2);
+// address register: serial, clock, latch
+ADDRESS_REGISTER(sro);
 
-ShiftRegisterUniversal sru(&PORTC, &DDRC, PINC0, PINC1, PINC2, PINC3, PINC4, PINC5);
+// data register: S0, S1, DS0, Q7, CP, OE1
+DATA_REGISTER(sru);
+
+#ifdef BOARD_HAS_GBA
+// AD input register of GBA cartridges: Q7, PL, CP
+INPUT_REGISTER(sri);
+#endif
 
-#define GBWR  PINB3
-#define GBRD  PINB4
 #define GBREQ PIND5
 #define LED1  PIND2
 #define LED2  PIND3
 
+// maximum number of payload bytes in a single binary frame
+#define FRAME_SIZE 128
+
+// size of a switchable ROM bank
+#define ROM_BANK_SIZE 0x4000
+
+// number of bytes covered by a single checksum in a BCRC reply
+#define CRC_BLOCK_SIZE 0x100
+
+// start byte of a command that is sent as a single frame
+#define CMD_FRAME ':'
+
+// reply to a framed command with an invalid checksum
+#define CMD_REJECT '!'
+
+// idle time after which a rejected command is considered to be discarded
+#define CMD_DISCARD_IDLE 20  // ms
+
+// maximum time between two bytes of the payload of WRBK
+#define BLOCK_RECEIVE_TIMEOUT 50  // ms
+
+// firmware version and capabilities reported upon HELO
+#define FIRMWARE_VERSION    0x0106
+#define CAP_BINARY_READ     (1 << 0)
+#define CAP_FRAMED_COMMAND  (1 << 1)
+#define CAP_BLOCK_WRITE     (1 << 2)
+#define CAP_BAUD_SWITCH     (1 << 3)
+#define CAP_RLE_READ        (1 << 4)
+#define CAP_CRC             (1 << 5)
+#define CAP_BENCHMARK       (1 << 6)
+#define CAP_DUMP            (1 << 7)
+#define CAP_BLOCK_CRC       (1 << 8)
+#define CAP_GBA             (1 << 9)
+#ifdef BOARD_HAS_GBA
+#define CAP_BOARD           CAP_GBA
+#else
+#define CAP_BOARD           0
+#endif
+#define CAPABILITIES        (CAP_BINARY_READ | CAP_FRAMED_COMMAND | CAP_BLOCK_WRITE | CAP_BAUD_SWITCH | \
+                             CAP_RLE_READ | CAP_CRC | CAP_BENCHMARK | CAP_DUMP | CAP_BLOCK_CRC | CAP_BOARD)
+
+// supported baud rates; bit i in the HELO reply corresponds to entry i
+const long baud_rates[] = {57600, 115200, 500000, 1000000, 2000000};
+#define NR_BAUD_RATES (sizeof(baud_rates) / sizeof(baud_rates[0]))
+
+// pattern that is used to test a new baud rate
+const uint8_t baud_test_pattern[] = {0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC,
+                                     0x01, 0x80, 0x7E, 0x81, 0xA5, 0x5A, 0x3C, 0xC3};
+#define BAUD_TEST_LENGTH  sizeof(baud_test_pattern)
+#define BAUD_TEST_TIMEOUT 250  // ms
+
 void reset_pins() {
     PORTB |= (1 << GBWR);     // no write
     PORTB |= (1 << GBRD);     // no read
@@ -97,6 +153,166 @@ void read_memory(uint16_t addr, uint16_t len) {
     sro.write_16bit(0);
 }
 
+/*
+ * send_frame
+ *
+ * Read memory from cartridge and send it as a single binary frame: a
+ * length byte, the payload and its CRC-16 (XMODEM)
+ *
+ * @param addr - Starting address
+ * @param flen - Bytes to read (at most FRAME_SIZE)
+ *
+ */
+void send_frame(uint16_t addr, uint8_t flen) {
+    uint16_t crc = 0;
+
+    SerialPort::get()->serial_send(flen);
+    for(uint8_t i=0; i<flen; i++) {
+        uint8_t val = read_byte(addr + i);
+        SerialPort::get()->serial_send(val);
+        crc = _crc_xmodem_update(crc, val);
+    }
+    SerialPort::get()->serial_send(crc >> 8);
+    SerialPort::get()->serial_send(crc & 0xFF);
+}
+
+/*
+ * read_memory_binary
+ *
+ * Read memory from cartridge. Results are communicated over SerialPort
+ * as raw bytes, grouped in frames. Every frame starts with a single
+ * length byte (1 - FRAME_SIZE) followed by that many data bytes and the
+ * CRC16 (XMODEM) of these data bytes (MSB first).
+ *
+ * @param addr - Starting address
+ * @param len  - Bytes to read
+ *
+ */
+void read_memory_binary(uint16_t addr, uint16_t len) {
+    char buf[10];
+
+    sprintf(buf, "ADDR%04X", addr);
+    SerialPort::get()->serial_send_line(buf, 8);
+    sprintf(buf, "SIZE%04X", len);
+    SerialPort::get()->serial_send_line(buf, 8);
+
+    uint16_t pos = addr;
+    uint16_t remaining = len;
+
+    PORTD |= (1 << LED2); // enable led2 (operation)
+    while(remaining > 0) {
+        uint8_t flen = remaining > FRAME_SIZE ? FRAME_SIZE : remaining;
+        send_frame(pos, flen);
+        pos += flen;
+        remaining -= flen;
+    }
+    PORTD &= ~(1 << LED2); // disable led2 (done)
+
+    // reset shift registers to 0
+    sro.write_16bit(0);
+}
+
+/*
+ * pack_bits
+ *
+ * Compress a block of data using PackBits run-length encoding. A header
+ * byte n in 0 - 127 is followed by n+1 literal bytes, a header byte n in
+ * 129 - 255 is followed by a single byte that is repeated 257-n times.
+ *
+ * @param src - Data to compress
+ * @param len - Number of bytes (at most 128)
+ * @param dst - Output buffer (at least len + 1 bytes)
+ *
+ * return number of compressed bytes
+ */
+uint8_t pack_bits(const uint8_t* src, uint8_t len, uint8_t* dst) {
+    uint8_t i = 0;
+    uint8_t o = 0;
+
+    while(i < len) {
+        uint8_t run = 1;
+        while(i + run < len && run < 128 && src[i + run] == src[i]) {
+            run++;
+        }
+
+        if(run >= 3) {
+            dst[o++] = 257 - run;
+            dst[o++] = src[i];
+            i += run;
+        } else {
+            // collect literals until a run of at least three bytes starts
+            uint8_t hdr = o++;
+            uint8_t n = 0;
+            while(i < len && n < 128) {
+                if(i + 2 < len && src[i] == src[i + 1] && src[i] == src[i + 2]) {
+                    break;
+                }
+                dst[o++] = src[i++];
+                n++;
+            }
+            dst[hdr] = n - 1;
+        }
+    }
+
+    return o;
+}
+
+/*
+ * read_memory_rle
+ *
+ * Read memory from cartridge. Results are communicated over SerialPort
+ * in binary frames like read_memory_binary, but every frame holds the
+ * PackBits compressed representation of (at most) FRAME_SIZE bytes. The
+ * CRC16 that follows each frame is calculated over the uncompressed
+ * data. The transfer ends with the total number of bytes that were sent, including
+ * the length bytes, as "CMPRXXXX".
+ *
+ * @param addr - Starting address
+ * @param len  - Bytes to read
+ *
+ */
+void read_memory_rle(uint16_t addr, uint16_t len) {
+    char buf[10];
+    uint8_t src[FRAME_SIZE];
+    uint8_t dst[FRAME_SIZE + 1];
+
+    sprintf(buf, "ADDR%04X", addr);
+    SerialPort::get()->serial_send_line(buf, 8);
+    sprintf(buf, "SIZE%04X", len);
+    SerialPort::get()->serial_send_line(buf, 8);
+
+    uint16_t pos = addr;
+    uint16_t remaining = len;
+    uint16_t sent = 0;
+
+    PORTD |= (1 << LED2); // enable led2 (operation)
+    while(remaining > 0) {
+        uint8_t flen = remaining > FRAME_SIZE ? FRAME_SIZE : remaining;
+        uint16_t crc = 0;
+        for(uint8_t i=0; i<flen; i++) {
+            src[i] = read_byte(pos);
+            crc = _crc_xmodem_update(crc, src[i]);
+            pos++;
+        }
+
+        uint8_t clen = pack_bits(src, flen, dst);
+        SerialPort::get()->serial_send(clen);
+        SerialPort::get()->serial_send_line((const char*)dst, clen);
+        SerialPort::get()->serial_send(crc >> 8);
+        SerialPort::get()->serial_send(crc & 0xFF);
+
+        sent += clen + 3;
+        remaining -= flen;
+    }
+    PORTD &= ~(1 << LED2); // disable led2 (done)
+
+    sprintf(buf, "CMPR%04X", sent);
+    SerialPort::get()->serial_send_line(buf, 8);
+
+    // reset shift registers to 0
+    sro.write_16bit(0);
+}
+
 /*
  * write_byte
  *
@@ -117,6 +333,191 @@ void write_byte(uint16_t addr, uint8_t byte) {
     PORTB |= (1 << GBWR);
 }
 
+/*
+ * select_rom_bank
+ *
+ * Switch the ROM bank. MBC1 maps a zero in the lower five bits of the bank
+ * number to one, such that banks 0x20, 0x40 and 0x60 cannot be mapped at
+ * 0x4000 - 0x7FFF; in RAM banking mode, these banks (and bank 0) appear at
+ * 0x0000 - 0x3FFF instead.
+ *
+ * @param type - Cartridge type (0x147 in the header)
+ * @param bank - ROM bank number
+ *
+ * return address at which the bank is visible
+ */
+uint16_t select_rom_bank(uint8_t type, uint16_t bank) {
+    if(type >= 1 && type <= 3 && (bank & 0x1F) == 0) {
+        // MBC1: RAM banking mode, upper bits only
+        write_byte(0x6000, 0x01);
+        write_byte(0x4000, bank >> 5);
+        return 0x0000;
+    }
+
+    if(bank == 0) {
+        return 0x0000;
+    }
+
+    if(type >= 0x19 && type <= 0x1E) {
+        // MBC5: lower 8 bits and bit 8 of the bank number
+        write_byte(0x2100, bank & 0xFF);
+        write_byte(0x3000, (bank >> 8) & 0x01);
+    } else if(type >= 5) {
+        // MBC2 and MBC3
+        write_byte(0x2100, bank & 0xFF);
+    } else {
+        // MBC1: ROM banking mode, upper and lower bits
+        write_byte(0x6000, 0x00);
+        write_byte(0x4000, bank >> 5);
+        write_byte(0x2100, bank & 0x1F);
+    }
+
+    return ROM_BANK_SIZE;
+}
+
+/*
+ * dump_rom
+ *
+ * Stream the complete ROM as binary frames; the firmware switches the
+ * banks itself, such that the host only needs to consume the stream.
+ * Any character received from the host aborts the transfer.
+ *
+ * @param type  - Cartridge type (0x147 in the header)
+ * @param banks - Number of 16 kb ROM banks
+ *
+ */
+void dump_rom(uint8_t type, uint16_t banks) {
+    char buf[10];
+
+    sprintf(buf, "TYPE%04X", type);
+    SerialPort::get()->serial_send_line(buf, 8);
+    sprintf(buf, "BNKS%04X", banks);
+    SerialPort::get()->serial_send_line(buf, 8);
+
+    PORTD |= (1 << LED2); // enable led2 (operation)
+    for(uint16_t bank=0; bank<banks; bank++) {
+        // without a controller, bank 1 is always visible at 0x4000
+        uint16_t addr = bank > 0 ? ROM_BANK_SIZE : 0x0000;
+        if(type != 0) {
+            addr = select_rom_bank(type, bank);
+        }
+
+        for(uint16_t pos=0; pos<ROM_BANK_SIZE; pos += FRAME_SIZE) {
+            if(SerialPort::get()->serial_available()) {
+                SerialPort::get()->serial_discard(CMD_DISCARD_IDLE);
+                bank = banks;
+                break;
+            }
+            send_frame(addr + pos, FRAME_SIZE);
+        }
+    }
+    PORTD &= ~(1 << LED2); // disable led2 (done)
+
+    // reset shift registers to 0
+    sro.write_16bit(0);
+}
+
+#ifdef BOARD_HAS_GBA
+/*
+ * gba_latch
+ *
+ * Start a sequential read of a GBA cartridge: the halfword address is put
+ * on AD0-AD15 and A16-A23 and latched by the cartridge when /CS goes low.
+ * Afterwards, AD0-AD15 are released such that the cartridge can drive them.
+ *
+ * @param haddr - Halfword address
+ *
+ */
+void gba_latch(uint32_t haddr) {
+    PORTD |= (1 << GBREQ);      // /CS high
+    PORTB &= ~(1 << GBA_OE);    // drive AD0-AD15
+
+    sro.write_16bit(haddr & 0xFFFF);
+    sru.write_8bit((haddr >> 16) & 0xFF);
+
+    PORTD &= ~(1 << GBREQ);     // /CS low latches the address
+    PORTB |= (1 << GBA_OE);     // release AD0-AD15
+}
+
+/*
+ * gba_read_halfword
+ *
+ * Read the halfword at the latched address; the cartridge advances to the
+ * next halfword upon the rising edge of /RD
+ *
+ * return halfword
+ */
+uint16_t gba_read_halfword() {
+    PORTB &= ~(1 << GBRD);
+
+    asm volatile("nop");
+    asm volatile("nop");
+    asm volatile("nop");
+
+    uint16_t input = sri.read_16bit();
+
+    PORTB |= (1 << GBRD);
+
+    return input;
+}
+
+/*
+ * gba_dump
+ *
+ * Stream a range of a GBA ROM as binary frames of FRAME_SIZE bytes (every
+ * halfword LSB first). The address is only latched at the start and where
+ * the counter inside the cartridge wraps (every 128 kb), all other reads
+ * are sequential bursts. Any character received from the host aborts the
+ * transfer.
+ *
+ * @param start  - Offset in kb
+ * @param kbytes - Number of kb to send
+ *
+ */
+void gba_dump(uint16_t start, uint16_t kbytes) {
+    char buf[10];
+
+    sprintf(buf, "OFFS%04X", start);
+    SerialPort::get()->serial_send_line(buf, 8);
+    sprintf(buf, "KBYT%04X", kbytes);
+    SerialPort::get()->serial_send_line(buf, 8);
+
+    // 512 halfwords per kb
+    const uint32_t first = (uint32_t)start << 9;
+    const uint32_t end = first + ((uint32_t)kbytes << 9);
+
+    PORTD |= (1 << LED2); // enable led2 (operation)
+    for(uint32_t haddr = first; haddr < end;) {
+        if(SerialPort::get()->serial_available()) {
+            SerialPort::get()->serial_discard(CMD_DISCARD_IDLE);
+            break;
+        }
+
+        uint16_t crc = 0;
+        SerialPort::get()->serial_send(FRAME_SIZE);
+        for(uint8_t i=0; i<FRAME_SIZE / 2; i++, haddr++) {
+            if(haddr == first || (haddr & 0xFFFF) == 0) {
+                gba_latch(haddr);
+            }
+
+            uint16_t val = gba_read_halfword();
+            SerialPort::get()->serial_send(val & 0xFF);
+            SerialPort::get()->serial_send(val >> 8);
+            crc = _crc_xmodem_update(crc, val & 0xFF);
+            crc = _crc_xmodem_update(crc, val >> 8);
+        }
+        SerialPort::get()->serial_send(crc >> 8);
+        SerialPort::get()->serial_send(crc & 0xFF);
+    }
+    PORTD |= (1 << GBREQ);      // /CS high
+    PORTB &= ~(1 << GBA_OE);    // back to GB mode
+    PORTD &= ~(1 << LED2); // disable led2 (done)
+
+    // reset shift registers to 0
+    sro.write_16bit(0);
+}
+#endif
+
 /*
  * write_ram
  *
@@ -139,6 +540,224 @@ void write_ram(uint16_t len) {
     sro.write_16bit(0);
 }
 
+/*
+ * write_block
+ *
+ * Receive a block of bytes over SerialPort and write these to the cartridge.
+ * Afterwards, the block is read back from the cartridge and its CRC16
+ * (XMODEM) is communicated as 'K' followed by the two checksum bytes
+ * (MSB first). When a byte of the block does not arrive in time, the
+ * remainder of the block is not written and CMD_REJECT is sent instead,
+ * such that the host can resynchronize right away.
+ *
+ * @param addr - Starting address
+ * @param len  - Bytes to write
+ *
+ */
+void write_block(uint16_t addr, uint16_t len) {
+    uint16_t crc = 0;
+
+    PORTD |= (1 << LED2); // enable led2 (operation)
+    for(uint16_t i=0; i<len; i++) {
+        int c = SerialPort::get()->serial_receive_timeout(BLOCK_RECEIVE_TIMEOUT);
+        if(c < 0) {
+            PORTD &= ~(1 << LED2); // disable led2 (done)
+            SerialPort::get()->serial_send(CMD_REJECT);
+            sro.write_16bit(0);
+            return;
+        }
+        write_byte(addr + i, c);
+    }
+
+    // verify against the cartridge
+    for(uint16_t i=0; i<len; i++) {
+        crc = _crc_xmodem_update(crc, read_byte(addr + i));
+    }
+    PORTD &= ~(1 << LED2); // disable led2 (done)
+
+    SerialPort::get()->serial_send('K');
+    SerialPort::get()->serial_send(crc >> 8);
+    SerialPort::get()->serial_send(crc & 0xFF);
+
+    // reset shift registers to 0
+    sro.write_16bit(0);
+}
+
+/*
+ * block_crc
+ *
+ * Communicate the CRC16 (XMODEM) of every block of CRC_BLOCK_SIZE bytes
+ * in a range of memory, such that the host only has to transfer the blocks
+ * that differ from a copy it already has. The reply starts with the number
+ * of blocks as CRCSxxxx, followed by the checksums (MSB first) and the
+ * CRC16 over all preceding checksum bytes.
+ *
+ * @param addr - Starting address
+ * @param len  - Bytes to cover (the last block may be shorter)
+ *
+ */
+void block_crc(uint16_t addr, uint16_t len) {
+    char buf[10];
+    uint16_t list_crc = 0;
+    uint16_t nrblocks = (len + CRC_BLOCK_SIZE - 1) / CRC_BLOCK_SIZE;
+
+    sprintf(buf, "CRCS%04X", nrblocks);
+    SerialPort::get()->serial_send_line(buf, 8);
+
+    PORTD |= (1 << LED2); // enable led2 (operation)
+    uint16_t pos = 0;
+    for(uint16_t b=0; b<nrblocks; b++) {
+        uint16_t blen = (len - pos) > CRC_BLOCK_SIZE ? CRC_BLOCK_SIZE : (len - pos);
+        uint16_t crc = 0;
+        for(uint16_t i=0; i<blen; i++) {
+            crc = _crc_xmodem_update(crc, read_byte(addr + pos + i));
+        }
+        pos += blen;
+
+        SerialPort::get()->serial_send(crc >> 8);
+        SerialPort::get()->serial_send(crc & 0xFF);
+        list_crc = _crc_xmodem_update(list_crc, crc >> 8);
+        list_crc = _crc_xmodem_update(list_crc, crc & 0xFF);
+    }
+    PORTD &= ~(1 << LED2); // disable led2 (done)
+
+    SerialPort::get()->serial_send(list_crc >> 8);
+    SerialPort::get()->serial_send(list_crc & 0xFF);
+
+    // reset shift registers to 0
+    sro.write_16bit(0);
+}
+
+/*
+ * hello
+ *
+ * Communicate firmware version, capabilities and supported baud rates
+ *
+ */
+void hello() {
+    char buf[10];
+
+    sprintf(buf, "VERS%04X", FIRMWARE_VERSION);
+    SerialPort::get()->serial_send_line(buf, 8);
+    sprintf(buf, "CAPS%04X", CAPABILITIES);
+    SerialPort::get()->serial_send_line(buf, 8);
+    sprintf(buf, "BAUD%04X", (1 << NR_BAUD_RATES) - 1);
+    SerialPort::get()->serial_send_line(buf, 8);
+}
+
+/*
+ * benchmark
+ *
+ * Measure the average number of clock cycles spent in a single call to
+ * read_byte using Timer1 and communicate it as CYCLxxxx. The cost of
+ * reading the timer itself is subtracted.
+ *
+ * @param n - number of reads to average over
+ *
+ */
+void benchmark(uint16_t n) {
+    char buf[10];
+    uint32_t cycles = 0;
+    uint16_t overhead;
+
+    if(n == 0) {
+        n = 1;
+    }
+
+    // make sure the transmitter is idle, such that no interrupts occur
+    SerialPort::get()->flush();
+
+    TCCR1A = 0;
+    TCCR1B = (1 << CS10);   // no prescaling: one count per clock cycle
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TCNT1 = 0;
+        overhead = TCNT1;
+    }
+
+    PORTD |= (1 << LED2); // enable led2 (operation)
+    for(uint16_t i=0; i<n; i++) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            TCNT1 = 0;
+            read_byte(i);
+            cycles += TCNT1 - overhead;
+        }
+    }
+    PORTD &= ~(1 << LED2); // disable led2 (done)
+
+    TCCR1B = 0;             // stop timer
+
+    sro.write_16bit(0);
+    reset_pins();
+
+    sprintf(buf, "CYCL%04X", (uint16_t)(cycles / n));
+    SerialPort::get()->serial_send_line(buf, 8);
+}
+
+/*
+ * receive_test_pattern
+ *
+ * Receive the baud test pattern, XOR-ed with mask, within the timeout
+ *
+ * @param mask - value to XOR the pattern with
+ *
+ * return whether the pattern was received correctly
+ */
+bool receive_test_pattern(uint8_t mask) {
+    bool valid = true;
+
+    for(uint8_t i=0; i<BAUD_TEST_LENGTH; i++) {
+        int c = SerialPort::get()->serial_receive_timeout(BAUD_TEST_TIMEOUT);
+        if(c < 0) {
+            return false;
+        }
+        if((uint8_t)c != (baud_test_pattern[i] ^ mask)) {
+            valid = false;
+        }
+    }
+
+    return valid;
+}
+
+/*
+ * change_baud
+ *
+ * Switch to another baud rate. At the new rate, the host sends the test
+ * pattern which is echoed, after which the host confirms with the inverted
+ * pattern. When either of these is not received in time, the previous
+ * baud rate is restored.
+ *
+ * @param idx - index of the baud rate in baud_rates
+ *
+ */
+void change_baud(uint8_t idx) {
+    char buf[10];
+
+    if(idx >= NR_BAUD_RATES) {
+        SerialPort::get()->serial_send_line("BAUDFFFF", 8);
+        return;
+    }
+
+    sprintf(buf, "BAUD%04X", idx);
+    SerialPort::get()->serial_send_line(buf, 8);
+    SerialPort::get()->flush();
+
+    long prev = SerialPort::get()->get_baud();
+    SerialPort::get()->set_baud(baud_rates[idx]);
+
+    if(receive_test_pattern(0x00)) {
+        SerialPort::get()->serial_send_line((const char*)baud_test_pattern, BAUD_TEST_LENGTH);
+        if(receive_test_pattern(0xFF)) {
+            return;
+        }
+    }
+
+    // test failed; fall back to the previous baud rate
+    SerialPort::get()->flush();
+    SerialPort::get()->set_baud(prev);
+    SerialPort::get()->serial_clear();
+}
+
 /*
  * char2hex4
  *
@@ -182,35 +801,108 @@ uint8_t char2hex2(char* c) {
  *
  * Get input command over serial;
  *
+ * A command is either sent character by character, in which case every
+ * character is echoed, or as a single frame starting with CMD_FRAME and
+ * ending with the CRC-8 of the 12 command characters. A framed command is
+ * acknowledged once by CMD_FRAME followed by the CRC-8. When the checksum
+ * does not match, CMD_REJECT is sent instead, the command is not executed
+ * and any data that follows it is discarded.
+ *
  * Extend this function to accept more commands
  *
  */
 void get_command() {
     char cmd[12];
     int cnt = 0;
-    while(cnt < 12) {
-        char c = SerialPort::get()->serial_receive();
-        if(c != 0) {
-            cmd[cnt] = c;
-            SerialPort::get()->serial_send(cmd[cnt]);
+
+    char c = SerialPort::get()->serial_receive();
+    if(c == CMD_FRAME) {
+        uint8_t crc = 0;
+        while(cnt < 12) {
+            cmd[cnt] = SerialPort::get()->serial_receive();
+            crc = _crc8_ccitt_update(crc, cmd[cnt]);
             cnt++;
         }
+
+        if((uint8_t)SerialPort::get()->serial_receive() != crc) {
+            SerialPort::get()->serial_send(CMD_REJECT);
+            SerialPort::get()->serial_send(crc);
+            SerialPort::get()->serial_discard(CMD_DISCARD_IDLE);
+            return;
+        }
+
+        SerialPort::get()->serial_send(CMD_FRAME);
+        SerialPort::get()->serial_send(crc);
+    } else {
+        while(cnt < 12) {
+            if(c != 0) {
+                cmd[cnt] = c;
+                SerialPort::get()->serial_send(cmd[cnt]);
+                cnt++;
+            }
+            if(cnt < 12) {
+                c = SerialPort::get()->serial_receive();
+            }
+        }
     }
 
     // command list
     //
     // READ XXXX XXXX --> read instruction
+    // RDBN XXXX XXXX --> read instruction (binary frames)
+    // RDRL XXXX XXXX --> read instruction (run-length encoded frames)
     // WRBY XXXX XXXX --> write single byte at specified address
     // WRIT ERAM XXXX --> write instruction
+    // WRBK XXXX XXXX --> write block of bytes and verify by read back
+    // HELO XXXX XXXX --> report version, capabilities and baud rates
+    // BAUD XXXX XXXX --> switch to baud rate with index XXXX (2nd)
+    // BNCH XXXX XXXX --> measure cycles per read over XXXX (2nd) reads
+    // DUMP XXXX XXXX --> stream XXXX (2nd) ROM banks of cartridge type XXXX (1st)
+    // BCRC XXXX XXXX --> CRC16 of every 256 byte block in XXXX (2nd) bytes from XXXX (1st)
+    // GBRD XXXX XXXX --> stream XXXX (2nd) kb of a GBA ROM from kb XXXX (1st)
 
     if(strncmp(cmd, "READ", 4) == 0) {
         uint16_t addr = char2hex4(&cmd[4]);
         uint16_t len  = char2hex4(&cmd[8]);
         read_memory(addr, len);
+    } else if(strncmp(cmd, "RDBN", 4) == 0) {
+        uint16_t addr = char2hex4(&cmd[4]);
+        uint16_t len  = char2hex4(&cmd[8]);
+        read_memory_binary(addr, len);
+    } else if(strncmp(cmd, "RDRL", 4) == 0) {
+        uint16_t addr = char2hex4(&cmd[4]);
+        uint16_t len  = char2hex4(&cmd[8]);
+        read_memory_rle(addr, len);
     } else if(strncmp(cmd, "WRBY", 4) == 0) {
         uint16_t addr = char2hex4(&cmd[4]);
         uint8_t value = char2hex2(&cmd[10]);
         write_byte(addr, value);
+    } else if(strncmp(cmd, "WRBK", 4) == 0) {
+        uint16_t addr = char2hex4(&cmd[4]);
+        uint16_t len  = char2hex4(&cmd[8]);
+        write_block(addr, len);
+    } else if(strncmp(cmd, "HELO", 4) == 0) {
+        hello();
+    } else if(strncmp(cmd, "BAUD", 4) == 0) {
+        uint16_t idx = char2hex4(&cmd[8]);
+        change_baud(idx);
+    } else if(strncmp(cmd, "BNCH", 4) == 0) {
+        uint16_t n = char2hex4(&cmd[8]);
+        benchmark(n);
+    } else if(strncmp(cmd, "DUMP", 4) == 0) {
+        uint8_t type   = char2hex4(&cmd[4]);
+        uint16_t banks = char2hex4(&cmd[8]);
+        dump_rom(type, banks);
+    } else if(strncmp(cmd, "BCRC", 4) == 0) {
+        uint16_t addr = char2hex4(&cmd[4]);
+        uint16_t len  = char2hex4(&cmd[8]);
+        block_crc(addr, len);
+#ifdef BOARD_HAS_GBA
+    } else if(strncmp(cmd, "GBRD", 4) == 0) {
+        uint16_t start  = char2hex4(&cmd[4]);
+        uint16_t kbytes = char2hex4(&cmd[8]);
+        gba_dump(start, kbytes);
+#endif
     } else if(strncmp(cmd, "WRITERAM", 8) == 0) {
         uint16_t len = char2hex4(&cmd[8]);
         write_ram(len);
@@ -233,6 +925,12 @@ void setup() {
     DDRD |= (1 << LED2);   // output
     DDRD |= (1 << GBREQ);  // output
 
+#ifdef BOARD_HAS_GBA
+    // address register drives AD0-AD15 unless a GBA cartridge is read
+    DDRB |= (1 << GBA_OE);    // output
+    PORTB &= ~(1 << GBA_OE);  // low
+#endif
+
     // set write high and read low to
     // disable write and enable read
     PORTB |= (1 << GBWR);     // high
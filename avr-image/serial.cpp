@@ -20,6 +20,56 @@
 
 #include "serial.h"
 
+// receive ring buffer, filled by the USART receive interrupt; the size
+// must be a power of two
+#define RX_BUFFER_SIZE 512
+
+static volatile uint8_t rx_buffer[RX_BUFFER_SIZE];
+static volatile uint16_t rx_head = 0;
+static uint16_t rx_tail = 0;
+
+// transmit ring buffer, drained by the USART data register empty
+// interrupt; the size must be a power of two
+#define TX_BUFFER_SIZE 128
+
+static volatile uint8_t tx_buffer[TX_BUFFER_SIZE];
+static volatile uint8_t tx_head = 0;
+static volatile uint8_t tx_tail = 0;
+
+/*
+ * USART data register empty interrupt
+ *
+ * move the next character from the ring buffer into the data register and
+ * disable this interrupt once the buffer is empty
+ *
+ */
+ISR(USART_UDRE_vect) {
+    UCSR0A = (UCSR0A & (1 << U2X0)) | (1 << TXC0);  // clear transmit complete flag
+    UDR0 = tx_buffer[tx_tail];
+    tx_tail = (tx_tail + 1) & (TX_BUFFER_SIZE - 1);
+
+    if(tx_head == tx_tail) {
+        UCSR0B &= ~(1 << UDRIE0);
+    }
+}
+
+/*
+ * USART receive interrupt
+ *
+ * store received character in the ring buffer; characters are dropped
+ * when the buffer is full
+ *
+ */
+ISR(USART_RX_vect) {
+    uint8_t c = UDR0;
+    uint16_t next = (rx_head + 1) & (RX_BUFFER_SIZE - 1);
+
+    if(next != rx_tail) {
+        rx_buffer[rx_head] = c;
+        rx_head = next;
+    }
+}
+
 /*
  * SerialPort()
  *
@@ -32,29 +82,66 @@ SerialPort::SerialPort(){
     this->f_cpu = F_CPU;
     this->set_baud(57600);
 
-    // high and low bits
-    UBRR0H = (this->baud_rate_calc >> 8);
-    UBRR0L = this->baud_rate_calc;
-
-    //transmit and receive enable
-    UCSR0B = (1 << TXEN0)| (1 << TXCIE0) | (1 << RXEN0) | (1 << RXCIE0);
+    //transmit and receive enable, receive interrupt enable
+    UCSR0B = (1 << TXEN0) | (1 << RXEN0) | (1 << RXCIE0);
     UCSR0C = (1 << UCSZ00) | (1 << UCSZ01);
+
+    sei();
 }
 
+/*
+ * set_baud()
+ *
+ * set the baud rate of the serial connection; double speed mode (U2X) is
+ * used such that rates up to f_cpu / 8 can be reached
+ *
+ */
 void SerialPort::set_baud(long _baud) {
     this->baud = _baud;
-    this->baud_rate_calc =  ((this->f_cpu / 16 / this->baud) - 1);
+    this->baud_rate_calc = ((this->f_cpu / 4 / this->baud) - 1) / 2;
+
+    // high and low bits
+    UBRR0H = (this->baud_rate_calc >> 8);
+    UBRR0L = this->baud_rate_calc;
+    UCSR0A = (1 << U2X0);
+}
+
+/*
+ * flush()
+ *
+ * wait until the last character has been transmitted
+ *
+ */
+void SerialPort::flush() {
+    while(tx_head != tx_tail) {};
+    while (( UCSR0A & (1<<TXC0))  == 0){};
 }
 
 /*
  * serial_send()
  *
- * send a single character over the serial connection
+ * send a single character over the serial connection; the character is
+ * placed in the transmit buffer such that the caller can continue while
+ * the character is being transmitted
  *
  */
 void SerialPort::serial_send(char data){
-    while (( UCSR0A & (1<<UDRE0))  == 0){};
-    UDR0 = data;
+    // write directly to the data register when nothing is pending
+    if(tx_head == tx_tail && (UCSR0A & (1<<UDRE0))) {
+        UCSR0A = (UCSR0A & (1 << U2X0)) | (1 << TXC0);  // clear transmit complete flag
+        UDR0 = data;
+        return;
+    }
+
+    uint8_t next = (tx_head + 1) & (TX_BUFFER_SIZE - 1);
+    while(next == tx_tail) {};  // wait while the buffer is full
+
+    tx_buffer[tx_head] = data;
+    tx_head = next;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        UCSR0B |= (1 << UDRIE0);
+    }
 }
 
 /*
@@ -72,10 +159,81 @@ void SerialPort::serial_send_line(const char str[], long len) {
 /*
  * serial_receive()
  *
- * wait until received
+ * wait until a character is available in the receive buffer
  *
  */
 char SerialPort::serial_receive (void) {
-    while(((UCSR0A) & (1 << RXC0)) == 0) {};  // wait while data is being received
-    return UDR0;
+    uint16_t head;
+    do {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            head = rx_head;
+        }
+    } while(head == rx_tail);  // wait while data is being received
+
+    char c = rx_buffer[rx_tail];
+    rx_tail = (rx_tail + 1) & (RX_BUFFER_SIZE - 1);
+    return c;
+}
+
+/*
+ * serial_receive_timeout()
+ *
+ * wait until received or until timeout_ms milliseconds have elapsed
+ *
+ * returns the received character or -1 upon timeout
+ *
+ */
+int SerialPort::serial_receive_timeout(uint16_t timeout_ms) {
+    for(uint32_t i=0; i < (uint32_t)timeout_ms * 100; i++) {
+        uint16_t head;
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            head = rx_head;
+        }
+
+        if(head != rx_tail) {
+            return (uint8_t)this->serial_receive();
+        }
+
+        _delay_us(10);
+    }
+
+    return -1;
+}
+
+/*
+ * serial_available()
+ *
+ * whether a character is waiting in the receive buffer
+ *
+ */
+bool SerialPort::serial_available() {
+    uint16_t head;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        head = rx_head;
+    }
+
+    return head != rx_tail;
+}
+
+/*
+ * serial_clear()
+ *
+ * discard all characters in the receive buffer
+ *
+ */
+void SerialPort::serial_clear() {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        rx_tail = rx_head;
+    }
+}
+
+/*
+ * serial_discard()
+ *
+ * discard all incoming characters until the line has been idle for
+ * idle_ms milliseconds
+ *
+ */
+void SerialPort::serial_discard(uint16_t idle_ms) {
+    while(this->serial_receive_timeout(idle_ms) >= 0) {};
 }
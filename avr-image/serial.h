@@ -22,6 +22,9 @@
 #define _SERIAL_H
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
 #include <string.h>
 
 class SerialPort {
@@ -39,9 +42,18 @@ public:
     void serial_send(char data);
     void serial_send_line(const char str[], long len);
     char serial_receive();
+    int serial_receive_timeout(uint16_t timeout_ms);
+    bool serial_available();
+    void serial_clear();
+    void serial_discard(uint16_t idle_ms);
+    void flush();
 
     void set_baud(long _baud);
 
+    inline long get_baud() const {
+        return this->baud;
+    }
+
 private:
     SerialPort();
 
@@ -82,4 +82,367 @@ public:
     void write_8bit(uint8_t state);
 };
 
+/*
+ * Port descriptors that bind a port at compile time
+ */
+#define SHIFT_REGISTER_PORT(name, port_reg, ddr_reg, pin_reg)                 \
+struct name {                                                                 \
+    static inline volatile uint8_t& port() { return port_reg; }               \
+    static inline volatile uint8_t& ddr()  { return ddr_reg; }                \
+    static inline volatile uint8_t& pin()  { return pin_reg; }                \
+};
+
+SHIFT_REGISTER_PORT(PortB, PORTB, DDRB, PINB)
+SHIFT_REGISTER_PORT(PortC, PORTC, DDRC, PINC)
+SHIFT_REGISTER_PORT(PortD, PORTD, DDRD, PIND)
+
+/*
+ * Class to control SIPO ShiftRegister such as the 74HC595
+ *
+ * Port and pins are template parameters, such that every pin access
+ * compiles to a single sbi/cbi instruction
+ */
+template<class PORT, uint8_t SER, uint8_t CLK, uint8_t RCK>
+class ShiftRegisterSIPOStatic {
+public:
+    ShiftRegisterSIPOStatic() {
+        // enable ports
+        PORT::ddr() |= (1 << SER);
+        PORT::ddr() |= (1 << CLK);
+        PORT::ddr() |= (1 << RCK);
+
+        // set ports to default value
+        PORT::port() &= ~(1 << SER);
+        PORT::port() &= ~(1 << CLK);
+        PORT::port() |=  (1 << RCK);
+    }
+
+    inline void write_8bit(uint8_t state) __attribute__((always_inline)) {
+        PORT::port() &= ~(1 << CLK);    // clock low
+        PORT::port() &= ~(1 << RCK);    // latch low
+
+        this->shift_8bit(state);
+
+        PORT::port() |= (1 << RCK);     // latch high
+    }
+
+    inline void write_16bit(uint16_t state) __attribute__((always_inline)) {
+        PORT::port() &= ~(1 << CLK);    // clock low
+        PORT::port() &= ~(1 << RCK);    // latch low
+
+        this->shift_8bit(state >> 8);
+        this->shift_8bit(state & 0xFF);
+
+        PORT::port() |= (1 << RCK);     // latch high
+    }
+
+private:
+    inline void shift_bit(uint8_t state, uint8_t bit) __attribute__((always_inline)) {
+        if(state & (1 << bit)) {
+            PORT::port() |= (1 << SER);
+        } else {
+            PORT::port() &= ~(1 << SER);
+        }
+
+        PORT::port() |= (1 << CLK);     // clock high
+        PORT::port() &= ~(1 << CLK);    // clock low
+    }
+
+    inline void shift_8bit(uint8_t state) __attribute__((always_inline)) {
+        this->shift_bit(state, 7);
+        this->shift_bit(state, 6);
+        this->shift_bit(state, 5);
+        this->shift_bit(state, 4);
+        this->shift_bit(state, 3);
+        this->shift_bit(state, 2);
+        this->shift_bit(state, 1);
+        this->shift_bit(state, 0);
+    }
+};
+
+/*
+ * Class to control Universal ShiftRegister such as the 74HC299
+ *
+ * Port and pins are template parameters, such that every pin access
+ * compiles to a single sbi/cbi/sbic instruction
+ */
+template<class PORT, uint8_t S0, uint8_t S1, uint8_t DS0, uint8_t Q7, uint8_t CP, uint8_t OE1>
+class ShiftRegisterUniversalStatic {
+public:
+    ShiftRegisterUniversalStatic() {
+        // enable ports
+        PORT::ddr() |= (1 << S0);       // output
+        PORT::ddr() |= (1 << S1);       // output
+        PORT::ddr() |= (1 << DS0);      // output
+        PORT::ddr() |= (1 << CP);       // output
+        PORT::ddr() |= (1 << OE1);      // output
+        PORT::ddr() &= ~(1 << Q7);      // input
+
+        PORT::port() &= ~(1 << S0);
+        PORT::port() &= ~(1 << S1);
+        PORT::port() &= ~(1 << DS0);
+        PORT::port() &= ~(1 << CP);
+        PORT::port() &= ~(1 << Q7);
+        PORT::port() |= (1 << OE1);     // start with disabling output
+    }
+
+    inline void write_8bit(uint8_t state) __attribute__((always_inline)) {
+        // clock low and disable output (while shifting)
+        PORT::port() &= ~(1 << CP);
+        PORT::port() |= (1 << OE1);
+
+        // enable shift right
+        PORT::port() |= (1 << S0);
+        PORT::port() &= ~(1 << S1);
+
+        this->write_bit(state, 7);
+        this->write_bit(state, 6);
+        this->write_bit(state, 5);
+        this->write_bit(state, 4);
+        this->write_bit(state, 3);
+        this->write_bit(state, 2);
+        this->write_bit(state, 1);
+        this->write_bit(state, 0);
+
+        // do nothing (halt) and enable output
+        PORT::port() &= ~(1 << S0);
+        PORT::port() &= ~(1 << S1);
+        PORT::port() &= ~(1 << OE1);
+    }
+
+    inline uint8_t read_8bit() __attribute__((always_inline)) {
+        uint8_t input = 0;
+
+        // clock low
+        PORT::port() &= ~(1 << CP);
+        PORT::port() |= (1 << OE1);     // disable output
+
+        // set parallel load and do clock pulse
+        PORT::port() |= (1 << S0);
+        PORT::port() |= (1 << S1);
+        PORT::port() |= (1 << CP);      // clock high
+        PORT::port() &= ~(1 << CP);     // clock low
+
+        // enable shift right
+        PORT::port() &= ~(1 << S1);
+
+        // read in data
+        this->read_bit(input, 7);
+        this->read_bit(input, 6);
+        this->read_bit(input, 5);
+        this->read_bit(input, 4);
+        this->read_bit(input, 3);
+        this->read_bit(input, 2);
+        this->read_bit(input, 1);
+        this->read_bit(input, 0);
+
+        // do nothing (halt)
+        PORT::port() &= ~(1 << S0);
+
+        return input;
+    }
+
+private:
+    inline void write_bit(uint8_t state, uint8_t bit) __attribute__((always_inline)) {
+        if(state & (1 << bit)) {
+            PORT::port() |= (1 << DS0);
+        } else {
+            PORT::port() &= ~(1 << DS0);
+        }
+
+        PORT::port() |= (1 << CP);      // clock high
+        PORT::port() &= ~(1 << CP);     // clock low
+    }
+
+    inline void read_bit(uint8_t& input, uint8_t bit) __attribute__((always_inline)) {
+        if(PORT::pin() & (1 << Q7)) {
+            input |= (1 << bit);
+        }
+
+        // toggle clock high -> low (clock pulse)
+        PORT::port() |= (1 << CP);
+        PORT::port() &= ~(1 << CP);
+    }
+};
+
+/*
+ * Class to control PISO ShiftRegister such as the 74HC165
+ *
+ * Port and pins are template parameters, such that every pin access
+ * compiles to a single sbi/cbi/sbic instruction. Two registers are
+ * cascaded by connecting Q7 of the low register to DS of the high
+ * register; the clock enable (CE) of both is tied low.
+ */
+template<class PORT, uint8_t Q7, uint8_t PL, uint8_t CP>
+class ShiftRegisterPISOStatic {
+public:
+    ShiftRegisterPISOStatic() {
+        // enable ports
+        PORT::ddr() &= ~(1 << Q7);      // input
+        PORT::ddr() |= (1 << PL);       // output
+        PORT::ddr() |= (1 << CP);       // output
+
+        PORT::port() &= ~(1 << Q7);
+        PORT::port() &= ~(1 << CP);
+        PORT::port() |= (1 << PL);      // start with shifting
+    }
+
+    inline uint8_t read_8bit() __attribute__((always_inline)) {
+        this->load();
+        return this->shift_8bit();
+    }
+
+    inline uint16_t read_16bit() __attribute__((always_inline)) {
+        this->load();
+        uint8_t hi = this->shift_8bit();
+        uint8_t lo = this->shift_8bit();
+        return (hi << 8) | lo;
+    }
+
+private:
+    inline void load() __attribute__((always_inline)) {
+        PORT::port() &= ~(1 << PL);     // parallel load
+        PORT::port() |= (1 << PL);      // shift
+    }
+
+    inline void read_bit(uint8_t& input, uint8_t bit) __attribute__((always_inline)) {
+        if(PORT::pin() & (1 << Q7)) {
+            input |= (1 << bit);
+        }
+
+        // toggle clock high -> low (clock pulse)
+        PORT::port() |= (1 << CP);
+        PORT::port() &= ~(1 << CP);
+    }
+
+    inline uint8_t shift_8bit() __attribute__((always_inline)) {
+        uint8_t input = 0;
+
+        this->read_bit(input, 7);
+        this->read_bit(input, 6);
+        this->read_bit(input, 5);
+        this->read_bit(input, 4);
+        this->read_bit(input, 3);
+        this->read_bit(input, 2);
+        this->read_bit(input, 1);
+        this->read_bit(input, 0);
+
+        return input;
+    }
+};
+
+/*
+ * Hardware SPI unit in master mode
+ *
+ * MOSI (PB3), MISO (PB4), SCK (PB5) and SS (PB2); SS has to be an output,
+ * else the unit falls back to slave mode when the pin is pulled low
+ */
+class SpiMaster {
+public:
+    static inline void init() {
+        DDRB |= (1 << PINB3);   // MOSI output
+        DDRB |= (1 << PINB5);   // SCK output
+        DDRB |= (1 << PINB2);   // SS output
+        DDRB &= ~(1 << PINB4);  // MISO input
+        PORTB &= ~(1 << PINB5); // clock idles low
+
+        // master, mode 0, MSB first, f_cpu / 2
+        SPCR = (1 << SPE) | (1 << MSTR);
+        SPSR = (1 << SPI2X);
+    }
+
+    static inline uint8_t transfer(uint8_t data) __attribute__((always_inline)) {
+        SPDR = data;
+        while(!(SPSR & (1 << SPIF))) {}
+        return SPDR;
+    }
+
+    // single clock pulse, generated while the SPI unit releases SCK
+    static inline void clock_pulse() __attribute__((always_inline)) {
+        SPCR &= ~(1 << SPE);
+        PORTB |= (1 << PINB5);
+        PORTB &= ~(1 << PINB5);
+        SPCR |= (1 << SPE);
+    }
+};
+
+/*
+ * Class to control SIPO ShiftRegister such as the 74HC595 through the
+ * hardware SPI unit; serial and clock are MOSI and SCK
+ */
+template<class PORT, uint8_t RCK>
+class ShiftRegisterSIPOSpi {
+public:
+    ShiftRegisterSIPOSpi() {
+        SpiMaster::init();
+        PORT::ddr() |= (1 << RCK);
+        PORT::port() |= (1 << RCK);
+    }
+
+    inline void write_8bit(uint8_t state) __attribute__((always_inline)) {
+        PORT::port() &= ~(1 << RCK);    // latch low
+        SpiMaster::transfer(state);
+        PORT::port() |= (1 << RCK);     // latch high
+    }
+
+    inline void write_16bit(uint16_t state) __attribute__((always_inline)) {
+        PORT::port() &= ~(1 << RCK);    // latch low
+        SpiMaster::transfer(state >> 8);
+        SpiMaster::transfer(state & 0xFF);
+        PORT::port() |= (1 << RCK);     // latch high
+    }
+};
+
+/*
+ * Class to control Universal ShiftRegister such as the 74HC299 through the
+ * hardware SPI unit; DS0, Q7 and CP are MOSI, MISO and SCK
+ */
+template<class PORT, uint8_t S0, uint8_t S1, uint8_t OE1>
+class ShiftRegisterUniversalSpi {
+public:
+    ShiftRegisterUniversalSpi() {
+        SpiMaster::init();
+
+        PORT::ddr() |= (1 << S0);       // output
+        PORT::ddr() |= (1 << S1);       // output
+        PORT::ddr() |= (1 << OE1);      // output
+
+        PORT::port() &= ~(1 << S0);
+        PORT::port() &= ~(1 << S1);
+        PORT::port() |= (1 << OE1);     // start with disabling output
+    }
+
+    inline void write_8bit(uint8_t state) __attribute__((always_inline)) {
+        PORT::port() |= (1 << OE1);     // disable output (while shifting)
+
+        // enable shift right
+        PORT::port() |= (1 << S0);
+        PORT::port() &= ~(1 << S1);
+
+        SpiMaster::transfer(state);
+
+        // do nothing (halt) and enable output
+        PORT::port() &= ~(1 << S0);
+        PORT::port() &= ~(1 << OE1);
+    }
+
+    inline uint8_t read_8bit() __attribute__((always_inline)) {
+        PORT::port() |= (1 << OE1);     // disable output
+
+        // set parallel load and do clock pulse
+        PORT::port() |= (1 << S0);
+        PORT::port() |= (1 << S1);
+        SpiMaster::clock_pulse();
+
+        // enable shift right and clock in data
+        PORT::port() &= ~(1 << S1);
+        uint8_t input = SpiMaster::transfer(0x00);
+
+        // do nothing (halt)
+        PORT::port() &= ~(1 << S0);
+
+        return input;
+    }
+};
+
 #endif
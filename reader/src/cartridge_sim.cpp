@@ -0,0 +1,321 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "cartridge_sim.h"
+
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <stdexcept>
+
+// the header has to be present to tell the memory bank controller
+static const size_t MIN_ROM_SIZE = 0x150;
+
+static const size_t ROM_BANK_SIZE = 0x4000;
+static const size_t RAM_BANK_SIZE = 0x2000;
+
+/**
+ * @brief      read a ROM image
+ *
+ * @param[in]  rom_file  path to the ROM image
+ *
+ * @return     contents of the image
+ */
+static std::vector<uint8_t> read_rom(const std::string& rom_file) {
+    std::ifstream in(rom_file.c_str(), std::ios::binary);
+    if(!in) {
+        throw std::runtime_error("Could not open ROM image " + rom_file);
+    }
+
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if(rom.size() < MIN_ROM_SIZE) {
+        throw std::runtime_error("ROM image " + rom_file + " is too small to hold a header");
+    }
+
+    return rom;
+}
+
+/**
+ * @brief      default constructor
+ *
+ * @param[in]  rom_file  path to the ROM image
+ */
+CartridgeSim::CartridgeSim(const std::string& rom_file) :
+    rom(read_rom(rom_file)),
+    ram_layout(rom[0x147], rom[0x149]) {
+
+    switch(this->rom[0x147]) {
+        case 0x01:  // MBC1
+        case 0x02:  // MBC1+RAM
+        case 0x03:  // MBC1+RAM+BATTERY
+            this->mapper = MAPPER_MBC1;
+        break;
+        case 0x05:  // MBC2
+        case 0x06:  // MBC2+BATTERY
+            this->mapper = MAPPER_MBC2;
+        break;
+        case 0x0F:  // MBC3+TIMER+BATTERY
+        case 0x10:  // MBC3+TIMER+RAM+BATTERY
+        case 0x11:  // MBC3
+        case 0x12:  // MBC3+RAM
+        case 0x13:  // MBC3+RAM+BATTERY
+            this->mapper = MAPPER_MBC3;
+        break;
+        case 0x19:  // MBC5
+        case 0x1A:  // MBC5+RAM
+        case 0x1B:  // MBC5+RAM+BATTERY
+        case 0x1C:  // MBC5+RUMBLE
+        case 0x1D:  // MBC5+RUMBLE+RAM
+        case 0x1E:  // MBC5+RUMBLE+RAM+BATTERY
+            this->mapper = MAPPER_MBC5;
+        break;
+        default:
+            this->mapper = MAPPER_NONE;
+        break;
+    }
+
+    // SRAM of a fresh cartridge holds random data; use a fixed value instead
+    this->ram.assign(this->ram_layout.get_size(), 0xFF);
+}
+
+/**
+ * @brief      read a byte from the bus
+ *
+ * @param[in]  addr  address
+ *
+ * @return     byte
+ */
+uint8_t CartridgeSim::read_byte(uint16_t addr) const {
+    if(addr < 0x8000) {
+        return this->rom[this->rom_offset(addr)];
+    }
+
+    if(addr >= 0xA000 && addr < 0xC000 && this->ram_accessible()) {
+        if(this->ram_layout.is_nibble()) {
+            // the upper four bits are not connected
+            return this->ram[this->ram_offset(addr)] | 0xF0;
+        }
+        return this->ram[this->ram_offset(addr)];
+    }
+
+    // open bus
+    return 0xFF;
+}
+
+/**
+ * @brief      write a byte to the bus
+ *
+ * @param[in]  addr  address
+ * @param[in]  val   byte
+ */
+void CartridgeSim::write_byte(uint16_t addr, uint8_t val) {
+    if(addr >= 0xA000 && addr < 0xC000) {
+        if(this->ram_accessible()) {
+            this->ram[this->ram_offset(addr)] = this->ram_layout.is_nibble() ? (val & 0x0F) : val;
+        }
+        return;
+    }
+
+    switch(this->mapper) {
+        case MAPPER_NONE:
+        break;
+        case MAPPER_MBC1:
+            if(addr < 0x2000) {
+                this->ram_enabled = (val & 0x0F) == 0x0A;
+            } else if(addr < 0x4000) {
+                // as on a real MBC1, only the lower five bits are compared
+                // with zero, such that banks 0x20, 0x40 and 0x60 cannot be
+                // mapped at 0x4000
+                this->rom_bank = (val & 0x1F) == 0 ? 1 : (val & 0x1F);
+            } else if(addr < 0x6000) {
+                this->upper_bank = val & 0x03;
+            } else if(addr < 0x8000) {
+                this->banking_mode = val & 0x01;
+            }
+        break;
+        case MAPPER_MBC2:
+            // bit 8 of the address tells the two registers apart
+            if(addr < 0x4000) {
+                if(addr & 0x0100) {
+                    this->rom_bank = (val & 0x0F) == 0 ? 1 : (val & 0x0F);
+                } else {
+                    this->ram_enabled = (val & 0x0F) == 0x0A;
+                }
+            }
+        break;
+        case MAPPER_MBC3:
+            if(addr < 0x2000) {
+                this->ram_enabled = (val & 0x0F) == 0x0A;
+            } else if(addr < 0x4000) {
+                this->rom_bank = (val & 0x7F) == 0 ? 1 : (val & 0x7F);
+            } else if(addr < 0x6000) {
+                // values 0x08 - 0x0C select the clock registers, which are
+                // not emulated
+                this->upper_bank = val & 0x0F;
+            }
+        break;
+        case MAPPER_MBC5:
+            if(addr < 0x2000) {
+                this->ram_enabled = (val & 0x0F) == 0x0A;
+            } else if(addr < 0x3000) {
+                this->rom_bank = (this->rom_bank & 0x100) | val;
+            } else if(addr < 0x4000) {
+                this->rom_bank = (this->rom_bank & 0xFF) | ((val & 0x01) << 8);
+            } else if(addr < 0x6000) {
+                this->upper_bank = val & 0x0F;
+            }
+        break;
+    }
+}
+
+/**
+ * @brief      read a halfword of a GBA ROM
+ *
+ * @param[in]  haddr  halfword address
+ *
+ * @return     halfword
+ */
+uint16_t CartridgeSim::read_gba_halfword(uint32_t haddr) const {
+    const size_t offset = (size_t)haddr * 2;
+    if(offset + 1 < this->rom.size()) {
+        return this->rom[offset] | (this->rom[offset + 1] << 8);
+    }
+
+    // without a ROM chip responding, the cartridge returns the lower bits
+    // of the address that was latched last
+    return haddr & 0xFFFF;
+}
+
+/**
+ * @brief      human readable description of the cartridge
+ */
+std::string CartridgeSim::describe() const {
+    static const char* names[] = {"ROM ONLY", "MBC1", "MBC2", "MBC3", "MBC5"};
+
+    std::stringstream str;
+    str << names[this->mapper] << ", " << this->rom.size() / 1024 << " KByte ROM, RAM: "
+        << this->ram_layout.describe();
+
+    return str.str();
+}
+
+/**
+ * @brief      fill the SRAM from a save file
+ *
+ * @param[in]  filename  save file; ignored when it does not exist
+ */
+void CartridgeSim::load_ram(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if(!in) {
+        return;
+    }
+
+    in.read((char*)this->ram.data(), this->ram.size());
+}
+
+/**
+ * @brief      store the SRAM in a save file
+ *
+ * @param[in]  filename  save file
+ */
+void CartridgeSim::save_ram(const std::string& filename) const {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    if(!out) {
+        throw std::runtime_error("Could not write save file " + filename);
+    }
+
+    out.write((const char*)this->ram.data(), this->ram.size());
+}
+
+/**
+ * @brief      reset the memory bank controller, as upon power-up
+ */
+void CartridgeSim::reset() {
+    this->ram_enabled = false;
+    this->rom_bank = 1;
+    this->upper_bank = 0;
+    this->banking_mode = 0;
+}
+
+/**
+ * @brief      offset in the ROM image of an address in 0x0000 - 0x7FFF
+ *
+ * @param[in]  addr  address
+ */
+size_t CartridgeSim::rom_offset(uint16_t addr) const {
+    size_t bank = 0;
+
+    if(addr < ROM_BANK_SIZE) {
+        // in RAM banking mode, MBC1 also applies the upper bits to bank 0
+        if(this->mapper == MAPPER_MBC1 && this->banking_mode == 1) {
+            bank = this->upper_bank << 5;
+        }
+    } else {
+        switch(this->mapper) {
+            case MAPPER_NONE:
+                bank = 1;
+            break;
+            case MAPPER_MBC1:
+                bank = (this->upper_bank << 5) | this->rom_bank;
+            break;
+            default:
+                bank = this->rom_bank;
+            break;
+        }
+    }
+
+    // banks beyond the end of the image mirror its start
+    return (bank * ROM_BANK_SIZE + (addr & (ROM_BANK_SIZE - 1))) % this->rom.size();
+}
+
+/**
+ * @brief      offset in the SRAM of an address in 0xA000 - 0xBFFF
+ *
+ * @param[in]  addr  address
+ */
+size_t CartridgeSim::ram_offset(uint16_t addr) const {
+    size_t bank = 0;
+
+    switch(this->mapper) {
+        case MAPPER_MBC1:
+            bank = this->banking_mode == 1 ? this->upper_bank : 0;
+        break;
+        case MAPPER_MBC3:
+        case MAPPER_MBC5:
+            bank = this->upper_bank;
+        break;
+        default:
+        break;
+    }
+
+    // RAM smaller than a bank (and MBC2 RAM) is mirrored
+    return (bank * RAM_BANK_SIZE + (addr - 0xA000)) % this->ram.size();
+}
+
+/**
+ * @brief      whether the SRAM can be accessed
+ */
+bool CartridgeSim::ram_accessible() const {
+    if(this->ram.empty()) {
+        return false;
+    }
+
+    return this->ram_enabled || !this->ram_layout.needs_enable();
+}
@@ -0,0 +1,166 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _CARTRIDGE_SIM_H
+#define _CARTRIDGE_SIM_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "ram_layout.h"
+
+/**
+ * @brief      emulates the bus of a cartridge on the basis of a ROM image,
+ *             such that the firmware commands can be answered without any
+ *             hardware
+ *
+ * The memory bank controller follows from the cartridge type (0x147) and
+ * the size of the SRAM from the RAM size (0x149), as on a real cartridge.
+ * ROM banks beyond the end of the image mirror its start. In GBA mode the
+ * image is read as halfwords instead; beyond its end, the open bus pattern
+ * of a GBA cartridge (the lower 16 bits of the halfword address) is read.
+ */
+class CartridgeSim {
+public:
+    // memory bank controller of the cartridge
+    enum Mapper {
+        MAPPER_NONE,        // 32 kb ROM, optionally with RAM
+        MAPPER_MBC1,
+        MAPPER_MBC2,
+        MAPPER_MBC3,
+        MAPPER_MBC5,
+    };
+
+private:
+    std::vector<uint8_t> rom;
+    std::vector<uint8_t> ram;
+
+    Mapper mapper = MAPPER_NONE;
+    RamLayout ram_layout;
+
+    // registers of the memory bank controller
+    bool ram_enabled = false;
+    uint16_t rom_bank = 1;          // lower bits of the ROM bank
+    uint8_t upper_bank = 0;         // MBC1 upper bits or RAM bank
+    uint8_t banking_mode = 0;       // MBC1 banking mode
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param[in]  rom_file  path to the ROM image
+     */
+    CartridgeSim(const std::string& rom_file);
+
+    /**
+     * @brief      read a byte from the bus
+     *
+     * @param[in]  addr  address
+     *
+     * @return     byte
+     */
+    uint8_t read_byte(uint16_t addr) const;
+
+    /**
+     * @brief      write a byte to the bus
+     *
+     * @param[in]  addr  address
+     * @param[in]  val   byte
+     */
+    void write_byte(uint16_t addr, uint8_t val);
+
+    /**
+     * @brief      read a halfword of a GBA ROM
+     *
+     * @param[in]  haddr  halfword address
+     *
+     * @return     halfword
+     */
+    uint16_t read_gba_halfword(uint32_t haddr) const;
+
+    /**
+     * @brief      memory bank controller of the cartridge
+     */
+    inline Mapper get_mapper() const {
+        return this->mapper;
+    }
+
+    /**
+     * @brief      SRAM of the cartridge
+     */
+    inline const RamLayout& get_ram_layout() const {
+        return this->ram_layout;
+    }
+
+    /**
+     * @brief      size of the ROM image
+     */
+    inline size_t get_rom_size() const {
+        return this->rom.size();
+    }
+
+    /**
+     * @brief      human readable description of the cartridge
+     */
+    std::string describe() const;
+
+    /**
+     * @brief      fill the SRAM from a save file
+     *
+     * @param[in]  filename  save file; ignored when it does not exist
+     */
+    void load_ram(const std::string& filename);
+
+    /**
+     * @brief      store the SRAM in a save file
+     *
+     * @param[in]  filename  save file
+     */
+    void save_ram(const std::string& filename) const;
+
+    /**
+     * @brief      reset the memory bank controller, as upon power-up
+     */
+    void reset();
+
+private:
+    /**
+     * @brief      offset in the ROM image of an address in 0x0000 - 0x7FFF
+     *
+     * @param[in]  addr  address
+     */
+    size_t rom_offset(uint16_t addr) const;
+
+    /**
+     * @brief      offset in the SRAM of an address in 0xA000 - 0xBFFF
+     *
+     * @param[in]  addr  address
+     */
+    size_t ram_offset(uint16_t addr) const;
+
+    /**
+     * @brief      whether the SRAM can be accessed
+     */
+    bool ram_accessible() const;
+};
+
+#endif
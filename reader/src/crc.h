@@ -0,0 +1,63 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _CRC_H
+#define _CRC_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      calculate CRC-8 (polynomial 0x07), identical to avr-libc's
+ *             _crc8_ccitt_update
+ *
+ * @param[in]  data  pointer to data
+ * @param[in]  len   number of bytes
+ * @param[in]  crc   initial value
+ *
+ * @return     checksum
+ */
+uint8_t crc8(const uint8_t* data, size_t len, uint8_t crc = 0);
+
+/**
+ * @brief      calculate CRC-16 (XMODEM), identical to avr-libc's
+ *             _crc_xmodem_update
+ *
+ * @param[in]  data  pointer to data
+ * @param[in]  len   number of bytes
+ * @param[in]  crc   initial value
+ *
+ * @return     checksum
+ */
+uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0);
+
+/**
+ * @brief      calculate CRC-32 (IEEE 802.3), identical to zlib's crc32;
+ *             pass the result of the previous call to continue a stream
+ *
+ * @param[in]  data  pointer to data
+ * @param[in]  len   number of bytes
+ * @param[in]  crc   checksum of the preceding data
+ *
+ * @return     checksum
+ */
+uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0);
+
+#endif
@@ -0,0 +1,329 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "dat_index.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char DatIndex::INDEX_MAGIC[8] = {'G', 'B', 'C', 'R', 'D', 'A', 'T', '1'};
+
+namespace {
+
+/**
+ * @brief      replace the entities of an XML attribute value
+ */
+std::string xml_unescape(const std::string& value) {
+    static const std::pair<const char*, char> entities[] = {
+        {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+
+    std::string result;
+    for(size_t i=0; i<value.size(); i++) {
+        if(value[i] != '&') {
+            result += value[i];
+            continue;
+        }
+
+        bool replaced = false;
+        for(const auto& entity : entities) {
+            if(value.compare(i, strlen(entity.first), entity.first) == 0) {
+                result += entity.second;
+                i += strlen(entity.first) - 1;
+                replaced = true;
+                break;
+            }
+        }
+
+        // numeric references outside of ASCII are kept as UTF-8
+        const size_t end = value.find(';', i);
+        if(!replaced && value.compare(i, 2, "&#") == 0 && end != std::string::npos) {
+            const size_t digits = i + (value[i+2] == 'x' ? 3 : 2);
+            const unsigned long c = strtoul(value.substr(digits, end - digits).c_str(), NULL,
+                                            value[i+2] == 'x' ? 16 : 10);
+            if(c < 0x80) {
+                result += (char)c;
+            } else if(c < 0x800) {
+                result += (char)(0xC0 | (c >> 6));
+                result += (char)(0x80 | (c & 0x3F));
+            } else {
+                result += (char)(0xE0 | (c >> 12));
+                result += (char)(0x80 | ((c >> 6) & 0x3F));
+                result += (char)(0x80 | (c & 0x3F));
+            }
+            i = end;
+            replaced = true;
+        }
+
+        if(!replaced) {
+            result += value[i];
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief      parse the attributes of an XML tag
+ *
+ * @param[in]  tag   contents of the tag, without the angle brackets
+ *
+ * @return     attributes by name
+ */
+std::map<std::string, std::string> xml_attributes(const std::string& tag) {
+    std::map<std::string, std::string> attributes;
+
+    size_t pos = 0;
+    while((pos = tag.find('=', pos)) != std::string::npos) {
+        size_t key_end = pos;
+        while(key_end > 0 && isspace((unsigned char)tag[key_end-1])) {
+            key_end--;
+        }
+        size_t key_begin = key_end;
+        while(key_begin > 0 && !isspace((unsigned char)tag[key_begin-1])) {
+            key_begin--;
+        }
+
+        const size_t quote = tag.find_first_of("\"'", pos);
+        if(quote == std::string::npos) {
+            break;
+        }
+        const size_t close = tag.find(tag[quote], quote + 1);
+        if(close == std::string::npos) {
+            break;
+        }
+
+        attributes[tag.substr(key_begin, key_end - key_begin)] = xml_unescape(tag.substr(quote + 1, close - quote - 1));
+        pos = close + 1;
+    }
+
+    return attributes;
+}
+
+/**
+ * @brief      convert a hex string into bytes
+ *
+ * @return     whether the string holds exactly len bytes
+ */
+bool parse_hex(const std::string& hex, uint8_t* data, size_t len) {
+    if(hex.size() != 2 * len) {
+        return false;
+    }
+
+    for(size_t i=0; i<len; i++) {
+        char* end = nullptr;
+        const std::string byte = hex.substr(2 * i, 2);
+        data[i] = strtoul(byte.c_str(), &end, 16);
+        if(*end != '\0') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+/**
+ * @brief      convert a DAT file into an index
+ *
+ * @param[in]  dat_path    path to the DAT file
+ * @param[in]  index_path  path to the index
+ */
+void DatIndex::build(const std::string& dat_path, const std::string& index_path) {
+    std::ifstream in(dat_path.c_str(), std::ios::binary);
+    if(!in) {
+        throw std::runtime_error("Could not open " + dat_path);
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string xml = buffer.str();
+
+    std::vector<Entry> entries;
+    std::string names;
+    std::string game;
+    uint32_t game_offset = 0;
+
+    // walk over the tags; every <rom> belongs to the enclosing <game> or
+    // <machine>
+    size_t pos = 0;
+    while((pos = xml.find('<', pos)) != std::string::npos) {
+        const size_t end = xml.find('>', pos);
+        if(end == std::string::npos) {
+            break;
+        }
+        const std::string tag = xml.substr(pos + 1, end - pos - 1);
+        const std::string element = tag.substr(0, tag.find_first_of(" \t\r\n/"));
+        pos = end + 1;
+
+        if(element == "game" || element == "machine") {
+            game = xml_attributes(tag)["name"];
+            game_offset = names.size();
+            names += game;
+        } else if(element == "rom" && !game.empty()) {
+            std::map<std::string, std::string> attributes = xml_attributes(tag);
+            Entry entry;
+            memset(&entry, 0, sizeof(entry));
+
+            uint8_t crc[4];
+            if(!parse_hex(attributes["crc"], crc, sizeof(crc))) {
+                continue;
+            }
+            entry.crc32 = (crc[0] << 24) | (crc[1] << 16) | (crc[2] << 8) | crc[3];
+            entry.size = strtoul(attributes["size"].c_str(), NULL, 10);
+            entry.flags |= parse_hex(attributes["md5"], entry.md5, sizeof(entry.md5)) ? HAS_MD5 : 0;
+            entry.flags |= parse_hex(attributes["sha1"], entry.sha1, sizeof(entry.sha1)) ? HAS_SHA1 : 0;
+            entry.name_offset = game_offset;
+            entry.name_len = game.size();
+            entries.push_back(entry);
+        }
+    }
+
+    if(entries.empty()) {
+        throw std::runtime_error("No ROMs found in " + dat_path + "; only Logiqx XML DAT files are supported");
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.crc32 < b.crc32;
+    });
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.count = entries.size();
+
+    // written next to the index and renamed, such that another process never
+    // maps a partial index
+    const std::string tmp = index_path + ".tmp";
+    std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+    out.write(names.data(), names.size());
+    out.close();
+    if(!out || std::rename(tmp.c_str(), index_path.c_str()) != 0) {
+        throw std::runtime_error("Could not write " + index_path);
+    }
+}
+
+/**
+ * @brief      default constructor; builds the index when it is missing or
+ *             older than the DAT file
+ *
+ * @param[in]  dat_path  path to the DAT file
+ */
+DatIndex::DatIndex(const std::string& dat_path) {
+    const std::string index_path = dat_path + ".idx";
+
+    struct stat st_dat, st_index;
+    if(stat(dat_path.c_str(), &st_dat) != 0) {
+        throw std::runtime_error("Could not open " + dat_path);
+    }
+    if(stat(index_path.c_str(), &st_index) != 0 || st_index.st_mtime < st_dat.st_mtime) {
+        DatIndex::build(dat_path, index_path);
+    }
+
+    this->fd = open(index_path.c_str(), O_RDONLY);
+    struct stat st;
+    if(this->fd < 0 || fstat(this->fd, &st) != 0) {
+        throw std::runtime_error("Could not open " + index_path);
+    }
+
+    this->map_size = st.st_size;
+    void* map = mmap(NULL, this->map_size, PROT_READ, MAP_SHARED, this->fd, 0);
+    if(map == MAP_FAILED) {
+        close(this->fd);
+        throw std::runtime_error("Could not map " + index_path);
+    }
+    this->map = (const uint8_t*)map;
+
+    this->header = (const Header*)this->map;
+    bool valid = this->map_size >= sizeof(Header) &&
+                 memcmp(this->header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+                 this->map_size >= sizeof(Header) + (uint64_t)this->header->count * sizeof(Entry);
+
+    if(valid) {
+        this->entries = (const Entry*)(this->map + sizeof(Header));
+        this->names = (const char*)(this->entries + this->header->count);
+
+        // a truncated or stale index may point beyond the name table
+        const uint64_t names_size = this->map_size - sizeof(Header) - (uint64_t)this->header->count * sizeof(Entry);
+        for(uint32_t i=0; i<this->header->count && valid; i++) {
+            valid = (uint64_t)this->entries[i].name_offset + this->entries[i].name_len <= names_size;
+        }
+    }
+
+    if(!valid) {
+        munmap((void*)this->map, this->map_size);
+        close(this->fd);
+        throw std::runtime_error("Invalid index " + index_path + "; remove it to rebuild");
+    }
+}
+
+/**
+ * @brief      find the game a ROM belongs to
+ *
+ * @param[in]  hashes  hashes of the ROM
+ * @param[out] name    name of the game
+ *
+ * @return     whether the DAT lists the ROM
+ */
+bool DatIndex::lookup(const RomHashes& hashes, std::string* name) const {
+    uint8_t md5[16];
+    uint8_t sha1[20];
+    parse_hex(hashes.md5, md5, sizeof(md5));
+    parse_hex(hashes.sha1, sha1, sizeof(sha1));
+
+    const Entry* end = this->entries + this->header->count;
+    const Entry* entry = std::lower_bound(this->entries, end, hashes.crc32, [](const Entry& e, uint32_t crc) {
+        return e.crc32 < crc;
+    });
+
+    // a CRC-32 may collide; the other hashes decide, when listed
+    for(; entry != end && entry->crc32 == hashes.crc32; entry++) {
+        if(entry->size != hashes.size ||
+           ((entry->flags & HAS_MD5) && memcmp(entry->md5, md5, sizeof(md5)) != 0) ||
+           ((entry->flags & HAS_SHA1) && memcmp(entry->sha1, sha1, sizeof(sha1)) != 0)) {
+            continue;
+        }
+
+        *name = std::string(this->names + entry->name_offset, entry->name_len);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief      Destroys the object.
+ */
+DatIndex::~DatIndex() {
+    munmap((void*)this->map, this->map_size);
+    close(this->fd);
+}
@@ -0,0 +1,113 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _DAT_INDEX_H
+#define _DAT_INDEX_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "rom_hasher.h"
+
+/**
+ * @brief      hash index of a DAT file (Logiqx XML, as used by No-Intro)
+ *
+ * Parsing the XML of a large DAT takes a while, hence it is converted once
+ * into a binary index next to it (<dat>.idx), which is rebuilt whenever the
+ * DAT is newer. The index is mapped into memory as is: a header, the
+ * entries sorted on CRC-32 and a table with the names of the games.
+ */
+class DatIndex {
+private:
+    struct Header {
+        char magic[8];              // INDEX_MAGIC
+        uint32_t count;             // number of entries
+        uint32_t reserved;
+    };
+
+    struct Entry {
+        uint32_t crc32;
+        uint32_t size;
+        uint8_t md5[16];
+        uint8_t sha1[20];
+        uint32_t name_offset;       // offset in the name table
+        uint32_t name_len;
+        uint32_t flags;             // which of the hashes are listed
+    };
+
+    enum {
+        HAS_MD5  = (1 << 0),
+        HAS_SHA1 = (1 << 1),
+    };
+
+    static const char INDEX_MAGIC[8];
+
+    int fd = -1;
+    const uint8_t* map = nullptr;   // mapped index
+    size_t map_size = 0;
+    const Header* header = nullptr;
+    const Entry* entries = nullptr;
+    const char* names = nullptr;
+
+    /**
+     * @brief      convert a DAT file into an index
+     *
+     * @param[in]  dat_path    path to the DAT file
+     * @param[in]  index_path  path to the index
+     */
+    static void build(const std::string& dat_path, const std::string& index_path);
+
+public:
+    /**
+     * @brief      default constructor; builds the index when it is missing
+     *             or older than the DAT file
+     *
+     * @param[in]  dat_path  path to the DAT file
+     */
+    DatIndex(const std::string& dat_path);
+
+    DatIndex(const DatIndex&) = delete;
+    DatIndex& operator=(const DatIndex&) = delete;
+
+    /**
+     * @brief      find the game a ROM belongs to
+     *
+     * @param[in]  hashes  hashes of the ROM
+     * @param[out] name    name of the game
+     *
+     * @return     whether the DAT lists the ROM
+     */
+    bool lookup(const RomHashes& hashes, std::string* name) const;
+
+    /**
+     * @brief      number of ROMs in the index
+     */
+    inline size_t get_size() const {
+        return this->header->count;
+    }
+
+    /**
+     * @brief      Destroys the object.
+     */
+    ~DatIndex();
+};
+
+#endif
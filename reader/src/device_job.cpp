@@ -0,0 +1,312 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "device_job.h"
+#include "gameboy_cartridge.h"
+#include "rom_store.h"
+#include "dat_index.h"
+
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+
+/**
+ * @brief      fill in the placeholders of a file name
+ *
+ * @param[in]  file_template  file name with placeholders
+ * @param[in]  title          cartridge title
+ * @param[in]  port_url       path to the serial port
+ * @param[in]  name           name of the game in the DAT file
+ *
+ * @return     file name
+ */
+std::string OutputNames::expand(const std::string& file_template, const std::string& title,
+                                const std::string& port_url, const std::string& name) {
+    // only keep characters that are safe in a file name
+    std::string safe_title;
+    for(char c : title) {
+        safe_title += (std::isalnum((unsigned char)c) || c == '-') ? c : '_';
+    }
+    if(safe_title.empty()) {
+        safe_title = "untitled";
+    }
+    const std::string port = port_url.substr(port_url.find_last_of('/') + 1);
+
+    // names from a DAT file are kept as they are, apart from path separators
+    std::string safe_name;
+    for(char c : name) {
+        safe_name += (c == '/' || c == '\\' || (unsigned char)c < 0x20) ? '_' : c;
+    }
+    if(safe_name.empty()) {
+        safe_name = safe_title;
+    }
+
+    std::string result = file_template;
+    const std::pair<std::string, std::string> placeholders[] = {
+        {"{title}", safe_title}, {"{port}", port}, {"{name}", safe_name}};
+    for(const auto& p : placeholders) {
+        size_t pos = 0;
+        while((pos = result.find(p.first, pos)) != std::string::npos) {
+            result.replace(pos, p.first.size(), p.second);
+            pos += p.second.size();
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief      fill in the placeholders of a file name and reserve it,
+ *             appending a number when the name is already in use
+ *
+ * @param[in]  file_template  file name with placeholders
+ * @param[in]  title          cartridge title
+ * @param[in]  port_url       path to the serial port
+ * @param[in]  name           name of the game in the DAT file
+ *
+ * @return     file name
+ */
+std::string OutputNames::claim(const std::string& file_template, const std::string& title,
+                               const std::string& port_url, const std::string& name) {
+    const std::string expanded = OutputNames::expand(file_template, title, port_url, name);
+
+    // insert the number in front of the extension, i.e. rom_2.gb
+    size_t dot = expanded.find_last_of('.');
+    if(dot == std::string::npos || dot < expanded.find_last_of('/') + 1) {
+        dot = expanded.size();
+    }
+
+    std::lock_guard<std::mutex> lock(this->mtx);
+    std::string candidate = expanded;
+    for(unsigned int i=2; this->names.count(candidate) > 0; i++) {
+        candidate = expanded.substr(0, dot) + "_" + std::to_string(i) + expanded.substr(dot);
+    }
+    this->names.insert(candidate);
+
+    return candidate;
+}
+
+/**
+ * @brief      hand back a file name once it is no longer written to
+ *
+ * @param[in]  name  file name
+ */
+void OutputNames::release(const std::string& name) {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->names.erase(name);
+}
+
+/**
+ * @brief      default constructor
+ *
+ * @param[in]  _port_url       path to /dev/ttyUSBx
+ * @param[in]  _type           one of the JOB_* values
+ * @param[in]  _file_template  file name, may contain placeholders
+ * @param[in]  _options        settings of the board
+ */
+DeviceJob::DeviceJob(const std::string& _port_url, int _type, const std::string& _file_template,
+                     const DeviceOptions& _options) :
+    port_url(_port_url),
+    type(_type),
+    file_template(_file_template),
+    options(_options) {}
+
+/**
+ * @brief      connect to the board and perform the transfer; errors are
+ *             stored rather than thrown, such that jobs can run on separate
+ *             threads
+ *
+ * @param      console  destination of progress messages
+ * @param      names    output file names in use
+ */
+void DeviceJob::run(std::ostream* console, OutputNames* names) {
+    auto start = std::chrono::system_clock::now();
+
+    try {
+        GameboyCartridge gbc(this->port_url);
+        gbc.set_console(console);
+        gbc.set_legacy_protocol(this->options.legacy);
+        gbc.set_max_baud_rate(this->options.baud);
+        gbc.set_compressed_read(this->options.compress);
+        gbc.set_verbose(this->options.verbose);
+        gbc.set_gba_mode(this->options.gba);
+        gbc.init();
+        this->transfer(&gbc, names, false);
+    } catch(ChecksumError& e) {
+        this->error = e.what();
+        this->checksum_mismatch = true;
+    } catch(std::exception& e) {
+        this->error = e.what();
+    }
+
+    std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - start;
+    this->seconds = elapsed_seconds.count();
+}
+
+/**
+ * @brief      perform the transfer on a board that is already connected
+ *
+ * @param      gbc          connected board
+ * @param      names        output file names in use
+ * @param[in]  read_header  whether to read the header first, as the
+ *                          cartridge may have been swapped
+ */
+void DeviceJob::transfer(GameboyCartridge* gbc, OutputNames* names, bool read_header) {
+    // the daemon keeps the board connected across jobs
+    gbc->reset_statistics();
+    if(read_header) {
+        gbc->read_header();
+    }
+    this->title = gbc->get_title();
+    gbc->set_resume(this->options.resume);
+    gbc->set_dat_index(this->options.dat);
+
+    switch(this->type) {
+        case JOB_BENCHMARK:
+            gbc->benchmark();
+        break;
+        case JOB_LOAD_RAM:
+            // several boards may be loaded from the same file
+            this->filename = OutputNames::expand(this->file_template, this->title, this->port_url);
+            this->bytes = gbc->load_ram(this->filename);
+        break;
+        case JOB_READ_RAM:
+            this->filename = names->claim(this->file_template, this->title, this->port_url);
+            this->bytes = gbc->read_ram(this->filename);
+        break;
+        default:
+            this->filename = names->claim(this->file_template, this->title, this->port_url);
+            // the store identifies cartridges by their GB header
+            if(this->options.store.empty() || this->options.gba) {
+                this->bytes = gbc->read_rom(this->filename);
+            } else {
+                this->read_rom_stored(gbc);
+            }
+            this->apply_dat_name(gbc, names);
+        break;
+    }
+}
+
+/**
+ * @brief      copy the ROM from the store when the cartridge is known and
+ *             passes a sampled verification, read it otherwise and add it to
+ *             the store
+ *
+ * @param      gbc   connected board
+ */
+void DeviceJob::read_rom_stored(GameboyCartridge* gbc) {
+    RomStore store(this->options.store);
+
+    std::string sha;
+    size_t size = 0;
+    if(!this->options.resume &&
+       store.lookup(this->title, gbc->get_header_checksum(), gbc->get_global_checksum(), &sha, &size) &&
+       gbc->verify_rom(store.object_path(sha))) {
+        store.retrieve(sha, this->filename);
+        this->from_store = true;
+        if(this->options.dat != nullptr) {
+            gbc->print_dat_match(RomHasher::hash_file(this->filename));
+        }
+        return;
+    }
+
+    this->bytes = gbc->read_rom(this->filename);
+    store.add(this->filename, this->title, gbc->get_header_checksum(), gbc->get_global_checksum());
+}
+
+/**
+ * @brief      rename the output file after the game in the DAT file, when
+ *             the file name asks for it
+ *
+ * @param      gbc    connected board
+ * @param      names  output file names in use
+ */
+void DeviceJob::apply_dat_name(GameboyCartridge* gbc, OutputNames* names) {
+    if(this->file_template.find("{name}") == std::string::npos || gbc->get_dat_match().empty() ||
+       OutputNames::expand(this->file_template, this->title, this->port_url, gbc->get_dat_match()) == this->filename) {
+        return;
+    }
+
+    const std::string renamed = names->claim(this->file_template, this->title, this->port_url,
+                                             gbc->get_dat_match());
+    if(std::rename(this->filename.c_str(), renamed.c_str()) != 0) {
+        names->release(renamed);
+        throw std::runtime_error("Could not rename " + this->filename + " to " + renamed);
+    }
+    names->release(this->filename);
+    this->filename = renamed;
+}
+
+/**
+ * @brief      perform the transfer on a board that is already connected,
+ *             storing errors rather than throwing them
+ *
+ * @param      gbc    connected board
+ * @param      names  output file names in use
+ */
+void DeviceJob::run(GameboyCartridge* gbc, OutputNames* names) {
+    auto start = std::chrono::system_clock::now();
+
+    try {
+        this->transfer(gbc, names, true);
+    } catch(ChecksumError& e) {
+        this->error = e.what();
+        this->checksum_mismatch = true;
+    } catch(std::exception& e) {
+        this->error = e.what();
+    }
+
+    // a board that stays connected may write the same file again later
+    if(!this->filename.empty()) {
+        names->release(this->filename);
+    }
+
+    std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - start;
+    this->seconds = elapsed_seconds.count();
+}
+
+/**
+ * @brief      single line report of the outcome of the job
+ */
+std::string DeviceJob::summary() const {
+    std::stringstream msg;
+    msg << "[" << this->port_url << "] ";
+
+    if(this->failed()) {
+        msg << "error: " << this->error;
+        return msg.str();
+    }
+
+    if(!this->title.empty()) {
+        msg << this->title << " ";
+    }
+    if(!this->filename.empty()) {
+        msg << (this->type == JOB_LOAD_RAM ? "<- " : "-> ") << this->filename << ": ";
+    }
+    if(this->from_store) {
+        msg << "copied from store, ";
+    }
+    msg << this->bytes << " bytes in " << std::fixed << std::setprecision(1) << this->seconds << " s ("
+        << (this->seconds > 0.0 ? this->bytes / 1024.0 / this->seconds : 0.0) << " KB/s)";
+
+    return msg.str();
+}
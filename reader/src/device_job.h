@@ -0,0 +1,215 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _DEVICE_JOB_H
+#define _DEVICE_JOB_H
+
+#include <string>
+#include <set>
+#include <mutex>
+#include <ostream>
+#include <cstddef>
+
+class GameboyCartridge;
+class DatIndex;
+
+/**
+ * @brief      settings that apply to every reader board
+ */
+struct DeviceOptions {
+    bool legacy = false;            // use hex encoded transfers
+    bool compress = false;          // use run-length encoded transfers
+    bool verbose = false;           // print link statistics
+    bool resume = false;            // continue an interrupted dump
+    bool gba = false;               // read GBA cartridges
+    unsigned int baud = 2000000;    // highest baud rate to negotiate
+    std::string store;              // directory of the ROM store, empty if unused
+    const DatIndex* dat = nullptr;  // catalogue to look dumps up in
+};
+
+/**
+ * @brief      hands out output file names, such that boards that run
+ *             concurrently never write to the same file
+ *
+ * A file name may contain the placeholders {title} (title from the
+ * cartridge header), {port} (name of the serial port) and {name} (name of
+ * the game in the DAT file, or the title when there is no match).
+ */
+class OutputNames {
+private:
+    std::mutex mtx;
+    std::set<std::string> names;    // names that have been handed out
+
+public:
+    /**
+     * @brief      fill in the placeholders of a file name
+     *
+     * @param[in]  file_template  file name with placeholders
+     * @param[in]  title          cartridge title
+     * @param[in]  port_url       path to the serial port
+     * @param[in]  name           name of the game in the DAT file
+     *
+     * @return     file name
+     */
+    static std::string expand(const std::string& file_template, const std::string& title,
+                              const std::string& port_url, const std::string& name = "");
+
+    /**
+     * @brief      fill in the placeholders of a file name and reserve it,
+     *             appending a number when the name is already in use
+     *
+     * @param[in]  file_template  file name with placeholders
+     * @param[in]  title          cartridge title
+     * @param[in]  port_url       path to the serial port
+     * @param[in]  name           name of the game in the DAT file
+     *
+     * @return     file name
+     */
+    std::string claim(const std::string& file_template, const std::string& title,
+                      const std::string& port_url, const std::string& name = "");
+
+    /**
+     * @brief      hand back a file name once it is no longer written to
+     *
+     * @param[in]  name  file name
+     */
+    void release(const std::string& name);
+};
+
+/**
+ * @brief      a single transfer on a single reader board
+ */
+class DeviceJob {
+public:
+    enum {
+        JOB_READ_ROM,
+        JOB_READ_RAM,
+        JOB_LOAD_RAM,
+        JOB_BENCHMARK,
+    };
+
+private:
+    std::string port_url;
+    int type;
+    std::string file_template;
+    DeviceOptions options;
+
+    std::string title;              // cartridge title
+    std::string filename;           // file that was read or written
+    size_t bytes = 0;               // bytes transferred
+    double seconds = 0.0;           // duration of the job
+    std::string error;              // reason of failure, empty on success
+    bool from_store = false;        // ROM was copied from the store
+    bool checksum_mismatch = false; // ROM was read, but fails its checksums
+
+    /**
+     * @brief      perform the transfer on a board that is already connected
+     *
+     * @param      gbc          connected board
+     * @param      names        output file names in use
+     * @param[in]  read_header  whether to read the header first, as the
+     *                          cartridge may have been swapped
+     */
+    void transfer(GameboyCartridge* gbc, OutputNames* names, bool read_header);
+
+    /**
+     * @brief      copy the ROM from the store when the cartridge is known
+     *             and passes a sampled verification, read it otherwise and
+     *             add it to the store
+     *
+     * @param      gbc   connected board
+     */
+    void read_rom_stored(GameboyCartridge* gbc);
+
+    /**
+     * @brief      rename the output file after the game in the DAT file,
+     *             when the file name asks for it
+     *
+     * @param      gbc    connected board
+     * @param      names  output file names in use
+     */
+    void apply_dat_name(GameboyCartridge* gbc, OutputNames* names);
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param[in]  _port_url       path to /dev/ttyUSBx
+     * @param[in]  _type           one of the JOB_* values
+     * @param[in]  _file_template  file name, may contain placeholders
+     * @param[in]  _options        settings of the board
+     */
+    DeviceJob(const std::string& _port_url, int _type, const std::string& _file_template,
+              const DeviceOptions& _options);
+
+    /**
+     * @brief      connect to the board and perform the transfer; errors are
+     *             stored rather than thrown, such that jobs can run on
+     *             separate threads
+     *
+     * @param      console  destination of progress messages
+     * @param      names    output file names in use
+     */
+    void run(std::ostream* console, OutputNames* names);
+
+    /**
+     * @brief      perform the transfer on a board that is already connected,
+     *             storing errors rather than throwing them
+     *
+     * @param      gbc    connected board
+     * @param      names  output file names in use
+     */
+    void run(GameboyCartridge* gbc, OutputNames* names);
+
+    /**
+     * @brief      single line report of the outcome of the job
+     */
+    std::string summary() const;
+
+    inline const std::string& get_port_url() const {
+        return this->port_url;
+    }
+
+    inline const std::string& get_filename() const {
+        return this->filename;
+    }
+
+    inline size_t get_bytes() const {
+        return this->bytes;
+    }
+
+    inline double get_seconds() const {
+        return this->seconds;
+    }
+
+    inline bool failed() const {
+        return !this->error.empty();
+    }
+
+    inline bool failed_checksum() const {
+        return this->checksum_mismatch;
+    }
+
+    inline const std::string& get_error() const {
+        return this->error;
+    }
+};
+
+#endif
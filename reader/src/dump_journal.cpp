@@ -0,0 +1,128 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "dump_journal.h"
+
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdio>
+
+/**
+ * @brief      default constructor
+ *
+ * @param[in]  _path  path to the journal
+ */
+DumpJournal::DumpJournal(const std::string& _path) :
+    path(_path) {}
+
+/**
+ * @brief      read an existing journal
+ *
+ * @param[in]  header_crc  CRC-16 of the cartridge header
+ * @param[in]  checksum    global checksum from the cartridge header
+ * @param[in]  size        size of the ROM
+ *
+ * @return     whether the journal exists and belongs to this cartridge
+ */
+bool DumpJournal::load(uint16_t header_crc, uint16_t checksum, size_t size) {
+    std::ifstream in(this->path.c_str());
+    if(!in) {
+        return false;
+    }
+
+    std::string key;
+    unsigned int j_header_crc = 0;
+    unsigned int j_checksum = 0;
+    size_t j_size = 0;
+    in >> key >> std::hex >> j_header_crc >> j_checksum >> std::dec >> j_size;
+    if(!in || key != "cartridge" || j_header_crc != header_crc || j_checksum != checksum || j_size != size) {
+        return false;
+    }
+
+    // an incomplete last line is the result of an interrupted write
+    this->banks.clear();
+    size_t bank = 0;
+    unsigned int crc = 0;
+    while(in >> key >> std::dec >> bank >> std::hex >> crc) {
+        if(key == "bank") {
+            this->banks[bank] = crc;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief      start a new journal, discarding any existing one
+ *
+ * @param[in]  header_crc  CRC-16 of the cartridge header
+ * @param[in]  checksum    global checksum from the cartridge header
+ * @param[in]  size        size of the ROM
+ */
+void DumpJournal::start(uint16_t header_crc, uint16_t checksum, size_t size) {
+    this->restart(header_crc, checksum, size, std::map<size_t, uint16_t>());
+}
+
+/**
+ * @brief      continue writing to a journal that was loaded, keeping only
+ *             the given banks
+ *
+ * @param[in]  header_crc  CRC-16 of the cartridge header
+ * @param[in]  checksum    global checksum from the cartridge header
+ * @param[in]  size        size of the ROM
+ * @param[in]  keep        completed banks that are still valid
+ */
+void DumpJournal::restart(uint16_t header_crc, uint16_t checksum, size_t size,
+                          const std::map<size_t, uint16_t>& keep) {
+    this->out.close();
+    this->out.open(this->path.c_str(), std::ios::trunc);
+    if(!this->out) {
+        throw std::runtime_error("Could not write journal " + this->path);
+    }
+
+    this->out << "cartridge " << std::hex << std::setfill('0') << std::setw(4) << header_crc << " "
+              << std::setw(4) << checksum << " " << std::dec << size << std::endl;
+
+    this->banks.clear();
+    for(const auto& bank : keep) {
+        this->complete(bank.first, bank.second);
+    }
+}
+
+/**
+ * @brief      record a completed bank
+ *
+ * @param[in]  bank  bank number
+ * @param[in]  crc   CRC-16 of the bank
+ */
+void DumpJournal::complete(size_t bank, uint16_t crc) {
+    this->banks[bank] = crc;
+    this->out << "bank " << std::dec << bank << " " << std::hex << std::setfill('0') << std::setw(4)
+              << crc << std::endl;
+}
+
+/**
+ * @brief      delete the journal once the dump has completed
+ */
+void DumpJournal::remove() {
+    this->out.close();
+    std::remove(this->path.c_str());
+}
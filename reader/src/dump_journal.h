@@ -0,0 +1,109 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _DUMP_JOURNAL_H
+#define _DUMP_JOURNAL_H
+
+#include <string>
+#include <fstream>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      sidecar file that records which banks of a dump are complete
+ *
+ * The journal starts with a line that identifies the cartridge, followed by
+ * a line per completed bank with the CRC-16 of its contents:
+ *
+ *     cartridge <header crc> <global checksum> <size>
+ *     bank <number> <crc>
+ *
+ * Every line is flushed as soon as it is written, such that the journal
+ * survives an interrupted dump.
+ */
+class DumpJournal {
+private:
+    std::string path;
+    std::ofstream out;
+    std::map<size_t, uint16_t> banks;  // completed banks and their CRC
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param[in]  _path  path to the journal
+     */
+    DumpJournal(const std::string& _path);
+
+    /**
+     * @brief      read an existing journal
+     *
+     * @param[in]  header_crc  CRC-16 of the cartridge header
+     * @param[in]  checksum    global checksum from the cartridge header
+     * @param[in]  size        size of the ROM
+     *
+     * @return     whether the journal exists and belongs to this cartridge
+     */
+    bool load(uint16_t header_crc, uint16_t checksum, size_t size);
+
+    /**
+     * @brief      start a new journal, discarding any existing one
+     *
+     * @param[in]  header_crc  CRC-16 of the cartridge header
+     * @param[in]  checksum    global checksum from the cartridge header
+     * @param[in]  size        size of the ROM
+     */
+    void start(uint16_t header_crc, uint16_t checksum, size_t size);
+
+    /**
+     * @brief      continue writing to a journal that was loaded, keeping
+     *             only the given banks
+     *
+     * @param[in]  header_crc  CRC-16 of the cartridge header
+     * @param[in]  checksum    global checksum from the cartridge header
+     * @param[in]  size        size of the ROM
+     * @param[in]  keep        completed banks that are still valid
+     */
+    void restart(uint16_t header_crc, uint16_t checksum, size_t size,
+                 const std::map<size_t, uint16_t>& keep);
+
+    /**
+     * @brief      record a completed bank
+     *
+     * @param[in]  bank  bank number
+     * @param[in]  crc   CRC-16 of the bank
+     */
+    void complete(size_t bank, uint16_t crc);
+
+    /**
+     * @brief      completed banks and their CRC
+     */
+    inline const std::map<size_t, uint16_t>& get_banks() const {
+        return this->banks;
+    }
+
+    /**
+     * @brief      delete the journal once the dump has completed
+     */
+    void remove();
+};
+
+#endif
@@ -0,0 +1,90 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _DUMP_PIPELINE_H
+#define _DUMP_PIPELINE_H
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "spsc_ring.h"
+#include "rom_writer.h"
+#include "dump_journal.h"
+#include "rom_verifier.h"
+
+/**
+ * @brief      data as received from the serial port
+ */
+struct DumpChunk {
+    size_t len;
+    uint8_t data[4096];
+};
+
+/**
+ * @brief      decoded frame that is ready to be stored
+ */
+struct DumpBlock {
+    size_t offset;      // offset in the ROM
+    size_t len;         // number of bytes
+    bool valid;         // whether the frame matched its checksum
+    uint8_t data[128];  // payload of a single frame
+};
+
+/**
+ * @brief      state shared by the stages of a ROM dump
+ *
+ * The serial reader thread passes chunks of raw data to the decode thread,
+ * which verifies the frames and passes their payload on to the sink thread.
+ * The sink writes the blocks to disk at their final offset, updates the
+ * checksums and prints the progress, such that the serial reader never waits
+ * on disk or console I/O. Only the rings hold data, hence the memory in use
+ * does not depend on the size of the ROM.
+ */
+struct DumpPipeline {
+    SpscRing<DumpChunk, 64> chunks;         // serial reader -> decoder
+    SpscRing<DumpBlock, 1024> blocks;       // decoder -> sink
+
+    std::atomic<bool> reader_done;          // no more chunks will be published
+    std::atomic<bool> decoder_done;         // no more blocks will be published
+    std::atomic<bool> abort;                // stream can no longer be followed
+
+    size_t total;                           // size of the ROM
+    size_t expected;                        // number of bytes the firmware sends
+    RomWriter* out;                         // output file
+    DumpJournal* journal;                   // records the completed banks
+    RomVerifier* verifier;                  // checksums of the stored bytes
+    RomHasher* hasher;                      // hashes of the stored bytes (without verifier)
+    std::vector<size_t> bank_bytes;         // bytes stored per bank
+
+    size_t lost_offset;                     // offset at which the stream was lost
+    std::vector<std::pair<size_t, size_t>> failed;  // corrupt blocks (offset, length)
+
+    DumpPipeline(size_t _total, size_t _expected, RomWriter* _out, DumpJournal* _journal,
+                 RomVerifier* _verifier, RomHasher* _hasher, size_t banks) :
+        reader_done(false), decoder_done(false), abort(false),
+        total(_total), expected(_expected), out(_out), journal(_journal), verifier(_verifier),
+        hasher(_hasher),
+        bank_bytes(banks, 0),
+        lost_offset(_total) {}
+};
+
+#endif
@@ -0,0 +1,803 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "firmware_sim.h"
+
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "crc.h"
+
+// firmware version and capabilities reported upon HELO
+static const unsigned int FIRMWARE_VERSION   = 0x0106;
+static const unsigned int CAP_BINARY_READ    = (1 << 0);
+static const unsigned int CAP_FRAMED_COMMAND = (1 << 1);
+static const unsigned int CAP_BLOCK_WRITE    = (1 << 2);
+static const unsigned int CAP_BAUD_SWITCH    = (1 << 3);
+static const unsigned int CAP_RLE_READ       = (1 << 4);
+static const unsigned int CAP_CRC            = (1 << 5);
+static const unsigned int CAP_BENCHMARK      = (1 << 6);
+static const unsigned int CAP_DUMP           = (1 << 7);
+static const unsigned int CAP_BLOCK_CRC      = (1 << 8);
+static const unsigned int CAP_GBA            = (1 << 9);
+
+// maximum number of payload bytes in a single binary frame
+static const size_t FRAME_SIZE = 128;
+
+// size of a switchable ROM bank
+static const size_t ROM_BANK_SIZE = 0x4000;
+
+// number of bytes covered by a single checksum in a BCRC reply
+static const size_t CRC_BLOCK_SIZE = 0x100;
+
+// start byte of a framed command and reply to one with an invalid checksum
+static const uint8_t CMD_FRAME = ':';
+static const uint8_t CMD_REJECT = '!';
+
+// idle time after which a rejected command is considered to be discarded
+static const unsigned int CMD_DISCARD_IDLE = 20;    // ms
+
+// maximum time between two bytes of the payload of WRBK
+static const unsigned int BLOCK_RECEIVE_TIMEOUT = 50;   // ms
+
+// pattern that is used to test a new baud rate
+static const uint8_t BAUD_TEST_PATTERN[] = {0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC,
+                                            0x01, 0x80, 0x7E, 0x81, 0xA5, 0x5A, 0x3C, 0xC3};
+static const unsigned int BAUD_TEST_TIMEOUT = 250;  // ms
+
+// clock frequency of the ATmega328P, to report BNCH results in cycles
+static const double CLOCK_MHZ = 16.0;
+
+// interval at which a blocked receive checks whether to stop
+static const int POLL_INTERVAL = 100;   // ms
+
+// gbcr has closed the port
+struct HostClosed {};
+
+// stop() has been called
+struct StopRequested {};
+
+volatile std::sig_atomic_t FirmwareSim::stop_requested = 0;
+
+/**
+ * @brief      convert hex characters to an unsigned int, like char2hex4 of
+ *             the firmware
+ *
+ * @param[in]  c     pointer to characters
+ * @param[in]  n     number of characters
+ *
+ * @return     value
+ */
+static unsigned int char2hex(const char* c, size_t n) {
+    char hv[5] = {'\0', '\0', '\0', '\0', '\0'};
+    memcpy(hv, c, n);
+    return strtoul(hv, NULL, 16);
+}
+
+/**
+ * @brief      compress a block of data using PackBits, identical to
+ *             pack_bits of the firmware
+ *
+ * @param[in]  src   data to compress
+ *
+ * @return     compressed data
+ */
+static std::vector<uint8_t> pack_bits(const std::vector<uint8_t>& src) {
+    std::vector<uint8_t> dst;
+    const size_t len = src.size();
+    size_t i = 0;
+
+    while(i < len) {
+        size_t run = 1;
+        while(i + run < len && run < 128 && src[i + run] == src[i]) {
+            run++;
+        }
+
+        if(run >= 3) {
+            dst.push_back(257 - run);
+            dst.push_back(src[i]);
+            i += run;
+        } else {
+            // collect literals until a run of at least three bytes starts
+            const size_t hdr = dst.size();
+            dst.push_back(0);
+            uint8_t n = 0;
+            while(i < len && n < 128) {
+                if(i + 2 < len && src[i] == src[i + 1] && src[i] == src[i + 2]) {
+                    break;
+                }
+                dst.push_back(src[i++]);
+                n++;
+            }
+            dst[hdr] = n - 1;
+        }
+    }
+
+    return dst;
+}
+
+/**
+ * @brief      default constructor
+ *
+ * @param      _cartridge  emulated cartridge
+ * @param[in]  max_baud    highest baud rate that is reported upon HELO
+ * @param[in]  _throttle   whether to limit replies to the baud rate
+ * @param[in]  _gba        whether to read the cartridge as a GBA ROM
+ * @param[in]  _legacy     whether to emulate the original firmware, which
+ *                         only supports READ, WRBY and WRITERAM
+ */
+FirmwareSim::FirmwareSim(CartridgeSim& _cartridge, size_t max_baud, bool _throttle, bool _gba, bool _legacy) :
+    cartridge(_cartridge),
+    gba(_gba),
+    legacy(_legacy),
+    throttle(_throttle) {
+
+    for(unsigned int i=0; i<this->BAUD_RATES.size(); i++) {
+        if(this->BAUD_RATES[i] <= max_baud) {
+            this->baud_mask |= (1 << i);
+        }
+    }
+    if(this->baud_mask == 0) {
+        throw std::runtime_error("The highest baud rate is below " + std::to_string(this->BAUD_RATE));
+    }
+
+    this->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(this->master < 0 || grantpt(this->master) != 0 || unlockpt(this->master) != 0) {
+        throw std::runtime_error("Could not open a pseudo-terminal");
+    }
+    this->port_name = ptsname(this->master);
+
+    // pass all bytes unaltered, as over a serial line
+    struct termios tio;
+    tcgetattr(this->master, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(this->master, TCSANOW, &tio);
+
+    this->reset();
+}
+
+/**
+ * @brief      default destructor
+ */
+FirmwareSim::~FirmwareSim() {
+    if(this->master >= 0) {
+        close(this->master);
+    }
+}
+
+/**
+ * @brief      process commands until stop() is called
+ */
+void FirmwareSim::run() {
+    while(this->wait_for_host()) {
+        try {
+            while(true) {
+                this->get_command();
+            }
+        } catch(const HostClosed&) {
+            // opening the port resets an Arduino
+            this->reset();
+        } catch(const StopRequested&) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief      stop processing commands; safe to call from a signal handler
+ */
+void FirmwareSim::stop() {
+    stop_requested = 1;
+}
+
+/**
+ * @brief      process a single command
+ */
+void FirmwareSim::get_command() {
+    char cmd[12];
+    int cnt = 0;
+
+    uint8_t c = this->receive();
+    if(c == CMD_FRAME && !this->legacy) {
+        for(cnt=0; cnt<12; cnt++) {
+            cmd[cnt] = this->receive();
+        }
+
+        const uint8_t crc = crc8((const uint8_t*)cmd, 12);
+        if(this->receive() != crc) {
+            const uint8_t reply[] = {CMD_REJECT, crc};
+            this->send(reply, 2);
+            this->discard(CMD_DISCARD_IDLE);
+            return;
+        }
+
+        const uint8_t reply[] = {CMD_FRAME, crc};
+        this->send(reply, 2);
+    } else {
+        // every character is echoed, null characters are skipped
+        while(cnt < 12) {
+            if(c != 0) {
+                cmd[cnt] = c;
+                this->send(&c, 1);
+                cnt++;
+            }
+            if(cnt < 12) {
+                c = this->receive();
+            }
+        }
+    }
+
+    const uint16_t arg1 = char2hex(&cmd[4], 4);
+    const uint16_t arg2 = char2hex(&cmd[8], 4);
+
+    if(strncmp(cmd, "READ", 4) == 0) {
+        this->read_memory(arg1, arg2);
+    } else if(strncmp(cmd, "WRBY", 4) == 0) {
+        this->cartridge.write_byte(arg1, char2hex(&cmd[10], 2));
+    } else if(strncmp(cmd, "WRITERAM", 8) == 0) {
+        this->write_ram(arg2);
+    } else if(this->legacy) {
+        // the original firmware ignores all other commands
+        return;
+    } else if(strncmp(cmd, "RDBN", 4) == 0) {
+        this->read_memory_binary(arg1, arg2);
+    } else if(strncmp(cmd, "RDRL", 4) == 0) {
+        this->read_memory_rle(arg1, arg2);
+    } else if(strncmp(cmd, "WRBK", 4) == 0) {
+        this->write_block(arg1, arg2);
+    } else if(strncmp(cmd, "HELO", 4) == 0) {
+        this->hello();
+    } else if(strncmp(cmd, "BAUD", 4) == 0) {
+        this->change_baud(arg2);
+    } else if(strncmp(cmd, "BNCH", 4) == 0) {
+        this->benchmark(arg2);
+    } else if(strncmp(cmd, "DUMP", 4) == 0) {
+        this->dump_rom(arg1, arg2);
+    } else if(strncmp(cmd, "BCRC", 4) == 0) {
+        this->block_crc(arg1, arg2);
+    } else if(strncmp(cmd, "GBRD", 4) == 0 && this->gba) {
+        this->gba_dump(arg1, arg2);
+    }
+}
+
+/**
+ * @brief      receive a byte, waiting for it as long as needed
+ */
+uint8_t FirmwareSim::receive() {
+    int c = -1;
+    while(c < 0) {
+        if(stop_requested) {
+            throw StopRequested();
+        }
+        c = this->receive_timeout(POLL_INTERVAL);
+    }
+
+    return c;
+}
+
+/**
+ * @brief      receive a byte within a timeout
+ *
+ * @param[in]  timeout  timeout in ms
+ *
+ * @return     byte or -1 upon timeout
+ */
+int FirmwareSim::receive_timeout(unsigned int timeout) {
+    if(this->rx_pos < this->rx_buffer.size()) {
+        return this->rx_buffer[this->rx_pos++];
+    }
+
+    struct pollfd pfd = {this->master, POLLIN, 0};
+    const int ret = poll(&pfd, 1, timeout);
+    if(ret < 0 && errno == EINTR) {
+        return -1;
+    } else if(ret < 0) {
+        throw std::runtime_error("Could not poll the pseudo-terminal");
+    } else if(ret == 0) {
+        return -1;
+    }
+
+    // the master reports a hang-up (or fails to read) once gbcr has closed
+    // the port
+    if(!(pfd.revents & POLLIN)) {
+        throw HostClosed();
+    }
+
+    this->rx_buffer.resize(4096);
+    const ssize_t n = read(this->master, this->rx_buffer.data(), this->rx_buffer.size());
+    if(n <= 0) {
+        this->rx_buffer.clear();
+        this->rx_pos = 0;
+        if(n < 0 && errno == EINTR) {
+            return -1;
+        }
+        throw HostClosed();
+    }
+    this->rx_buffer.resize(n);
+    this->rx_pos = 1;
+
+    return this->rx_buffer[0];
+}
+
+/**
+ * @brief      whether any received bytes are waiting
+ */
+bool FirmwareSim::available() {
+    if(this->rx_pos < this->rx_buffer.size()) {
+        return true;
+    }
+
+    struct pollfd pfd = {this->master, POLLIN, 0};
+    return poll(&pfd, 1, 0) > 0;
+}
+
+/**
+ * @brief      drop received bytes until the host has been silent for the
+ *             given time
+ *
+ * @param[in]  idle  idle time in ms
+ */
+void FirmwareSim::discard(unsigned int idle) {
+    while(this->receive_timeout(idle) >= 0) {}
+}
+
+/**
+ * @brief      send bytes to the host at the current baud rate
+ *
+ * @param[in]  data  pointer to data
+ * @param[in]  len   number of bytes
+ */
+void FirmwareSim::send(const uint8_t* data, size_t len) {
+    size_t sent = 0;
+    while(sent < len) {
+        const ssize_t n = write(this->master, data + sent, len - sent);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        } else if(n <= 0) {
+            throw HostClosed();
+        }
+        sent += n;
+    }
+
+    if(!this->throttle) {
+        return;
+    }
+
+    // a start bit, eight data bits and a stop bit per byte; the sender only
+    // sleeps once it is ahead of the link by more than a millisecond, which
+    // keeps the average rate exact without sleeping for every byte
+    const auto now = std::chrono::steady_clock::now();
+    if(this->link_free < now) {
+        this->link_free = now;
+    }
+    this->link_free += std::chrono::nanoseconds(len * 10 * 1000000000ull / this->baud_rate);
+    if(this->link_free - now > std::chrono::milliseconds(1)) {
+        std::this_thread::sleep_until(this->link_free);
+    }
+}
+
+/**
+ * @brief      send a reply line, such as ADDRxxxx
+ *
+ * @param[in]  line  characters to send
+ */
+void FirmwareSim::send_line(const std::string& line) {
+    this->send((const uint8_t*)line.data(), line.size());
+}
+
+/**
+ * @brief      send memory as a binary frame: length byte, payload and its
+ *             CRC-16 (MSB first)
+ *
+ * @param[in]  data  payload
+ */
+void FirmwareSim::send_frame(const std::vector<uint8_t>& data) {
+    const uint16_t crc = crc16(data.data(), data.size());
+
+    std::vector<uint8_t> frame;
+    frame.reserve(data.size() + 3);
+    frame.push_back(data.size());
+    frame.insert(frame.end(), data.begin(), data.end());
+    frame.push_back(crc >> 8);
+    frame.push_back(crc & 0xFF);
+
+    this->send(frame.data(), frame.size());
+}
+
+/**
+ * @brief      wait until gbcr opens the port
+ *
+ * @return     false when stop() was called in the meantime
+ */
+bool FirmwareSim::wait_for_host() {
+    while(!stop_requested) {
+        // the master keeps reporting a hang-up as long as the port is closed
+        struct pollfd pfd = {this->master, POLLIN, 0};
+        if(poll(&pfd, 1, POLL_INTERVAL) > 0 && !(pfd.revents & POLLHUP)) {
+            return true;
+        }
+        if(pfd.revents & POLLHUP) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL));
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief      return to the state after a reset of the reader
+ */
+void FirmwareSim::reset() {
+    this->rx_buffer.clear();
+    this->rx_pos = 0;
+    this->baud_rate = this->BAUD_RATE;
+    this->link_free = std::chrono::steady_clock::now();
+    this->cartridge.reset();
+}
+
+/**
+ * @brief      READ: memory as hex characters
+ *
+ * @param[in]  addr  starting address
+ * @param[in]  len   number of bytes
+ */
+void FirmwareSim::read_memory(uint16_t addr, uint16_t len) {
+    char buf[10];
+    std::string reply;
+
+    sprintf(buf, "ADDR%04X", addr);
+    reply += buf;
+    sprintf(buf, "SIZE%04X", len);
+    reply += buf;
+
+    for(uint16_t pos = addr; pos < (uint16_t)(addr + len); pos++) {
+        sprintf(buf, "%02X", this->cartridge.read_byte(pos));
+        reply += buf;
+    }
+
+    this->send_line(reply);
+}
+
+/**
+ * @brief      RDBN: memory as binary frames
+ *
+ * @param[in]  addr  starting address
+ * @param[in]  len   number of bytes
+ */
+void FirmwareSim::read_memory_binary(uint16_t addr, uint16_t len) {
+    char buf[20];
+    sprintf(buf, "ADDR%04XSIZE%04X", addr, len);
+    this->send_line(buf);
+
+    std::vector<uint8_t> data;
+    for(size_t pos=0; pos<len; pos+=FRAME_SIZE) {
+        data.clear();
+        for(size_t i=pos; i<len && i<pos+FRAME_SIZE; i++) {
+            data.push_back(this->cartridge.read_byte(addr + i));
+        }
+        this->send_frame(data);
+    }
+}
+
+/**
+ * @brief      RDRL: memory as PackBits compressed frames
+ *
+ * @param[in]  addr  starting address
+ * @param[in]  len   number of bytes
+ */
+void FirmwareSim::read_memory_rle(uint16_t addr, uint16_t len) {
+    char buf[20];
+    sprintf(buf, "ADDR%04XSIZE%04X", addr, len);
+    this->send_line(buf);
+
+    std::vector<uint8_t> data;
+    uint16_t sent = 0;
+    for(size_t pos=0; pos<len; pos+=FRAME_SIZE) {
+        data.clear();
+        for(size_t i=pos; i<len && i<pos+FRAME_SIZE; i++) {
+            data.push_back(this->cartridge.read_byte(addr + i));
+        }
+
+        // the checksum covers the uncompressed data
+        const uint16_t crc = crc16(data.data(), data.size());
+        std::vector<uint8_t> frame = pack_bits(data);
+        frame.insert(frame.begin(), frame.size());
+        frame.push_back(crc >> 8);
+        frame.push_back(crc & 0xFF);
+        this->send(frame.data(), frame.size());
+        sent += frame.size();
+    }
+
+    sprintf(buf, "CMPR%04X", sent);
+    this->send_line(buf);
+}
+
+/**
+ * @brief      WRITERAM: write bytes to 0xA000, echoing every byte
+ *
+ * @param[in]  len   number of bytes
+ */
+void FirmwareSim::write_ram(uint16_t len) {
+    for(uint16_t i=0; i<len; i++) {
+        const uint8_t c = this->receive();
+        this->send(&c, 1);
+        this->cartridge.write_byte(0xA000 + i, c);
+    }
+}
+
+/**
+ * @brief      WRBK: write a block and reply with the CRC-16 read back, or
+ *             with CMD_REJECT when the block does not arrive in time
+ *
+ * @param[in]  addr  starting address
+ * @param[in]  len   number of bytes
+ */
+void FirmwareSim::write_block(uint16_t addr, uint16_t len) {
+    for(uint16_t i=0; i<len; i++) {
+        const int c = this->receive_timeout(BLOCK_RECEIVE_TIMEOUT);
+        if(c < 0) {
+            this->send(&CMD_REJECT, 1);
+            return;
+        }
+        this->cartridge.write_byte(addr + i, c);
+    }
+
+    // verify against the cartridge
+    uint16_t crc = 0;
+    for(uint16_t i=0; i<len; i++) {
+        const uint8_t val = this->cartridge.read_byte(addr + i);
+        crc = crc16(&val, 1, crc);
+    }
+
+    const uint8_t reply[] = {'K', (uint8_t)(crc >> 8), (uint8_t)(crc & 0xFF)};
+    this->send(reply, 3);
+}
+
+/**
+ * @brief      BCRC: CRC-16 of every 256 byte block of memory
+ *
+ * @param[in]  addr  starting address
+ * @param[in]  len   number of bytes
+ */
+void FirmwareSim::block_crc(uint16_t addr, uint16_t len) {
+    char buf[10];
+    const size_t nrblocks = (len + CRC_BLOCK_SIZE - 1) / CRC_BLOCK_SIZE;
+    sprintf(buf, "CRCS%04X", (unsigned int)nrblocks);
+
+    std::vector<uint8_t> crcs;
+    std::vector<uint8_t> block;
+    for(size_t pos=0; pos<len; pos+=CRC_BLOCK_SIZE) {
+        block.clear();
+        for(size_t i=pos; i<len && i<pos+CRC_BLOCK_SIZE; i++) {
+            block.push_back(this->cartridge.read_byte(addr + i));
+        }
+        const uint16_t crc = crc16(block.data(), block.size());
+        crcs.push_back(crc >> 8);
+        crcs.push_back(crc & 0xFF);
+    }
+    const uint16_t list_crc = crc16(crcs.data(), crcs.size());
+    crcs.push_back(list_crc >> 8);
+    crcs.push_back(list_crc & 0xFF);
+
+    this->send_line(buf);
+    this->send(crcs.data(), crcs.size());
+}
+
+/**
+ * @brief      HELO: version, capabilities and baud rates
+ */
+void FirmwareSim::hello() {
+    unsigned int caps = CAP_BINARY_READ | CAP_FRAMED_COMMAND | CAP_BLOCK_WRITE | CAP_BAUD_SWITCH |
+                        CAP_RLE_READ | CAP_CRC | CAP_BENCHMARK | CAP_DUMP | CAP_BLOCK_CRC;
+    if(this->gba) {
+        caps |= CAP_GBA;
+    }
+
+    char buf[30];
+    sprintf(buf, "VERS%04XCAPS%04XBAUD%04X", FIRMWARE_VERSION, caps, this->baud_mask);
+    this->send_line(buf);
+}
+
+/**
+ * @brief      BNCH: clock cycles (at 16 MHz) spent per emulated read
+ *
+ * @param[in]  n     number of reads to average over
+ */
+void FirmwareSim::benchmark(uint16_t n) {
+    if(n == 0) {
+        n = 1;
+    }
+
+    volatile uint8_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for(uint16_t i=0; i<n; i++) {
+        sink ^= this->cartridge.read_byte(i);
+    }
+    const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double cycles = elapsed.count() * CLOCK_MHZ / n;
+    char buf[10];
+    sprintf(buf, "CYCL%04X", cycles > 0xFFFF ? 0xFFFF : (unsigned int)cycles);
+    this->send_line(buf);
+}
+
+/**
+ * @brief      BAUD: switch the baud rate after a link test
+ *
+ * @param[in]  idx   index in BAUD_RATES
+ */
+void FirmwareSim::change_baud(uint16_t idx) {
+    char buf[10];
+
+    if(idx >= this->BAUD_RATES.size() || !(this->baud_mask & (1 << idx))) {
+        this->send_line("BAUDFFFF");
+        return;
+    }
+
+    sprintf(buf, "BAUD%04X", idx);
+    this->send_line(buf);
+
+    const size_t prev = this->baud_rate;
+    this->baud_rate = this->BAUD_RATES[idx];
+
+    // the pattern is echoed and confirmed by the inverted pattern
+    if(this->receive_test_pattern(0x00)) {
+        this->send(BAUD_TEST_PATTERN, sizeof(BAUD_TEST_PATTERN));
+        if(this->receive_test_pattern(0xFF)) {
+            return;
+        }
+    }
+
+    // test failed; fall back to the previous baud rate
+    this->baud_rate = prev;
+    this->rx_buffer.clear();
+    this->rx_pos = 0;
+}
+
+/**
+ * @brief      receive the baud test pattern, XOR-ed with mask, within the
+ *             timeout
+ *
+ * @param[in]  mask  value to XOR the pattern with
+ *
+ * @return     whether the pattern was received correctly
+ */
+bool FirmwareSim::receive_test_pattern(uint8_t mask) {
+    bool valid = true;
+
+    for(size_t i=0; i<sizeof(BAUD_TEST_PATTERN); i++) {
+        const int c = this->receive_timeout(BAUD_TEST_TIMEOUT);
+        if(c < 0) {
+            return false;
+        }
+        if((uint8_t)c != (BAUD_TEST_PATTERN[i] ^ mask)) {
+            valid = false;
+        }
+    }
+
+    return valid;
+}
+
+/**
+ * @brief      DUMP: stream all ROM banks as binary frames
+ *
+ * @param[in]  type   cartridge type (0x147 in the header)
+ * @param[in]  banks  number of ROM banks
+ */
+void FirmwareSim::dump_rom(uint8_t type, uint16_t banks) {
+    char buf[20];
+    sprintf(buf, "TYPE%04XBNKS%04X", type, banks);
+    this->send_line(buf);
+
+    std::vector<uint8_t> data(FRAME_SIZE);
+    for(uint16_t bank=0; bank<banks; bank++) {
+        // without a controller, bank 1 is always visible at 0x4000
+        uint16_t addr = bank > 0 ? ROM_BANK_SIZE : 0x0000;
+        if(type != 0) {
+            addr = this->select_rom_bank(type, bank);
+        }
+
+        for(size_t pos=0; pos<ROM_BANK_SIZE; pos+=FRAME_SIZE) {
+            // any character received from the host aborts the transfer
+            if(this->available()) {
+                this->discard(CMD_DISCARD_IDLE);
+                return;
+            }
+            for(size_t i=0; i<FRAME_SIZE; i++) {
+                data[i] = this->cartridge.read_byte(addr + pos + i);
+            }
+            this->send_frame(data);
+        }
+    }
+}
+
+/**
+ * @brief      GBRD: stream a range of a GBA ROM as binary frames
+ *
+ * @param[in]  start   offset in kb
+ * @param[in]  kbytes  number of kb
+ */
+void FirmwareSim::gba_dump(uint16_t start, uint16_t kbytes) {
+    char buf[20];
+    sprintf(buf, "OFFS%04XKBYT%04X", start, kbytes);
+    this->send_line(buf);
+
+    // 512 halfwords per kb, every halfword LSB first
+    const uint32_t first = (uint32_t)start << 9;
+    const uint32_t end = first + ((uint32_t)kbytes << 9);
+    std::vector<uint8_t> data(FRAME_SIZE);
+    for(uint32_t haddr = first; haddr < end; haddr += FRAME_SIZE / 2) {
+        if(this->available()) {
+            this->discard(CMD_DISCARD_IDLE);
+            return;
+        }
+        for(size_t i=0; i<FRAME_SIZE / 2; i++) {
+            const uint16_t val = this->cartridge.read_gba_halfword(haddr + i);
+            data[2 * i] = val & 0xFF;
+            data[2 * i + 1] = val >> 8;
+        }
+        this->send_frame(data);
+    }
+}
+
+/**
+ * @brief      switch the ROM bank, as the firmware does in DUMP
+ *
+ * @param[in]  type  cartridge type (0x147 in the header)
+ * @param[in]  bank  ROM bank number
+ *
+ * @return     address at which the bank is visible
+ */
+uint16_t FirmwareSim::select_rom_bank(uint8_t type, uint16_t bank) {
+    if(type >= 1 && type <= 3 && (bank & 0x1F) == 0) {
+        // MBC1: RAM banking mode, upper bits only
+        this->cartridge.write_byte(0x6000, 0x01);
+        this->cartridge.write_byte(0x4000, bank >> 5);
+        return 0x0000;
+    }
+
+    if(bank == 0) {
+        return 0x0000;
+    }
+
+    if(type >= 0x19 && type <= 0x1E) {
+        // MBC5: lower 8 bits and bit 8 of the bank number
+        this->cartridge.write_byte(0x2100, bank & 0xFF);
+        this->cartridge.write_byte(0x3000, (bank >> 8) & 0x01);
+    } else if(type >= 5) {
+        // MBC2 and MBC3
+        this->cartridge.write_byte(0x2100, bank & 0xFF);
+    } else {
+        // MBC1: ROM banking mode, upper and lower bits
+        this->cartridge.write_byte(0x6000, 0x00);
+        this->cartridge.write_byte(0x4000, bank >> 5);
+        this->cartridge.write_byte(0x2100, bank & 0x1F);
+    }
+
+    return ROM_BANK_SIZE;
+}
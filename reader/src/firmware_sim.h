@@ -0,0 +1,276 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _FIRMWARE_SIM_H
+#define _FIRMWARE_SIM_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstddef>
+
+#include "cartridge_sim.h"
+
+/**
+ * @brief      emulates the firmware of the reader behind a pseudo-terminal,
+ *             such that gbcr can be run against a ROM image without any
+ *             hardware
+ *
+ * The commands of get_command() in the firmware are answered in the same
+ * way, including the echo of commands that are sent character by character
+ * and the CRC-8 acknowledgement of framed commands. Replies are throttled to
+ * the rate of the negotiated baud rate (10 bits per byte), such that the
+ * throughput of the protocol can be compared with that of a real reader.
+ * Closing the port has the same effect as the reset of an Arduino: the baud
+ * rate and the memory bank controller return to their initial state.
+ */
+class FirmwareSim {
+private:
+    CartridgeSim& cartridge;
+
+    int master = -1;                    // master side of the pseudo-terminal
+    std::string port_name;              // slave side, opened by gbcr
+
+    std::vector<uint8_t> rx_buffer;     // received but not yet processed
+    size_t rx_pos = 0;
+
+    bool gba;                           // whether GBRD is supported
+    bool legacy;                        // whether to only support the hex protocol
+    bool throttle;                      // whether to limit replies to the baud rate
+    unsigned int baud_mask = 0;         // supported entries of BAUD_RATES
+    size_t baud_rate;                   // current baud rate
+    std::chrono::steady_clock::time_point link_free;    // end of the last reply on the link
+
+    static volatile std::sig_atomic_t stop_requested;
+
+    const size_t BAUD_RATE = 57600;     // baud rate after a reset
+    const std::vector<size_t> BAUD_RATES = {57600, 115200, 500000, 1000000, 2000000};
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param      _cartridge  emulated cartridge
+     * @param[in]  max_baud    highest baud rate that is reported upon HELO
+     * @param[in]  _throttle   whether to limit replies to the baud rate
+     * @param[in]  _gba        whether to read the cartridge as a GBA ROM
+     * @param[in]  _legacy     whether to emulate the original firmware,
+     *                         which only supports READ, WRBY and WRITERAM
+     */
+    FirmwareSim(CartridgeSim& _cartridge, size_t max_baud, bool _throttle, bool _gba, bool _legacy);
+
+    /**
+     * @brief      default destructor
+     */
+    ~FirmwareSim();
+
+    /**
+     * @brief      path of the port to open in gbcr
+     */
+    inline const std::string& get_port() const {
+        return this->port_name;
+    }
+
+    /**
+     * @brief      process commands until stop() is called
+     */
+    void run();
+
+    /**
+     * @brief      stop processing commands; safe to call from a signal
+     *             handler
+     */
+    static void stop();
+
+private:
+    /**
+     * @brief      process a single command
+     */
+    void get_command();
+
+    /**
+     * @brief      receive a byte, waiting for it as long as needed
+     */
+    uint8_t receive();
+
+    /**
+     * @brief      receive a byte within a timeout
+     *
+     * @param[in]  timeout  timeout in ms
+     *
+     * @return     byte or -1 upon timeout
+     */
+    int receive_timeout(unsigned int timeout);
+
+    /**
+     * @brief      whether any received bytes are waiting
+     */
+    bool available();
+
+    /**
+     * @brief      drop received bytes until the host has been silent for
+     *             the given time
+     *
+     * @param[in]  idle  idle time in ms
+     */
+    void discard(unsigned int idle);
+
+    /**
+     * @brief      send bytes to the host at the current baud rate
+     *
+     * @param[in]  data  pointer to data
+     * @param[in]  len   number of bytes
+     */
+    void send(const uint8_t* data, size_t len);
+
+    /**
+     * @brief      send a reply line, such as ADDRxxxx
+     *
+     * @param[in]  line  characters to send
+     */
+    void send_line(const std::string& line);
+
+    /**
+     * @brief      send memory as a binary frame: length byte, payload and
+     *             its CRC-16 (MSB first)
+     *
+     * @param[in]  data  payload
+     */
+    void send_frame(const std::vector<uint8_t>& data);
+
+    /**
+     * @brief      wait until gbcr opens the port
+     *
+     * @return     false when stop() was called in the meantime
+     */
+    bool wait_for_host();
+
+    /**
+     * @brief      return to the state after a reset of the reader
+     */
+    void reset();
+
+    /**
+     * @brief      READ: memory as hex characters
+     *
+     * @param[in]  addr  starting address
+     * @param[in]  len   number of bytes
+     */
+    void read_memory(uint16_t addr, uint16_t len);
+
+    /**
+     * @brief      RDBN: memory as binary frames
+     *
+     * @param[in]  addr  starting address
+     * @param[in]  len   number of bytes
+     */
+    void read_memory_binary(uint16_t addr, uint16_t len);
+
+    /**
+     * @brief      RDRL: memory as PackBits compressed frames
+     *
+     * @param[in]  addr  starting address
+     * @param[in]  len   number of bytes
+     */
+    void read_memory_rle(uint16_t addr, uint16_t len);
+
+    /**
+     * @brief      WRITERAM: write bytes to 0xA000, echoing every byte
+     *
+     * @param[in]  len   number of bytes
+     */
+    void write_ram(uint16_t len);
+
+    /**
+     * @brief      WRBK: write a block and reply with the CRC-16 read back, or
+     *             with CMD_REJECT when the block does not arrive in time
+     *
+     * @param[in]  addr  starting address
+     * @param[in]  len   number of bytes
+     */
+    void write_block(uint16_t addr, uint16_t len);
+
+    /**
+     * @brief      BCRC: CRC-16 of every 256 byte block of memory
+     *
+     * @param[in]  addr  starting address
+     * @param[in]  len   number of bytes
+     */
+    void block_crc(uint16_t addr, uint16_t len);
+
+    /**
+     * @brief      HELO: version, capabilities and baud rates
+     */
+    void hello();
+
+    /**
+     * @brief      BNCH: clock cycles (at 16 MHz) spent per emulated read
+     *
+     * @param[in]  n     number of reads to average over
+     */
+    void benchmark(uint16_t n);
+
+    /**
+     * @brief      BAUD: switch the baud rate after a link test
+     *
+     * @param[in]  idx   index in BAUD_RATES
+     */
+    void change_baud(uint16_t idx);
+
+    /**
+     * @brief      receive the baud test pattern, XOR-ed with mask, within
+     *             the timeout
+     *
+     * @param[in]  mask  value to XOR the pattern with
+     *
+     * @return     whether the pattern was received correctly
+     */
+    bool receive_test_pattern(uint8_t mask);
+
+    /**
+     * @brief      DUMP: stream all ROM banks as binary frames
+     *
+     * @param[in]  type   cartridge type (0x147 in the header)
+     * @param[in]  banks  number of ROM banks
+     */
+    void dump_rom(uint8_t type, uint16_t banks);
+
+    /**
+     * @brief      GBRD: stream a range of a GBA ROM as binary frames
+     *
+     * @param[in]  start   offset in kb
+     * @param[in]  kbytes  number of kb
+     */
+    void gba_dump(uint16_t start, uint16_t kbytes);
+
+    /**
+     * @brief      switch the ROM bank, as the firmware does in DUMP
+     *
+     * @param[in]  type  cartridge type (0x147 in the header)
+     * @param[in]  bank  ROM bank number
+     *
+     * @return     address at which the bank is visible
+     */
+    uint16_t select_rom_bank(uint8_t type, uint16_t bank);
+};
+
+#endif
@@ -29,39 +29,112 @@ GameboyCartridge::GameboyCartridge(const std::string& _port_url) :
     port(io)    // initialize port upon construction
 {
     this->port_url = _port_url;
+    this->rx_buffer.resize(this->RX_BUFFER_SIZE);
     port.open(this->port_url.c_str());
-    port.set_option(boost::asio::serial_port_base::baud_rate(this->BAUD_RATE));
+    this->set_port_baud_rate(this->BAUD_RATE);
 }
 
 /**
  * @brief      load cartridge information
  */
 void GameboyCartridge::init() {
+    if(!this->legacy_protocol) {
+        *this->console << "Query firmware capabilities..." << std::flush;
+        if(this->query_hello(false)) {
+            *this->console << "DONE" << std::endl;
+            *this->console << "Firmware version: " << (this->firmware_version >> 8) << "."
+                           << (this->firmware_version & 0xFF) << std::endl;
+            this->negotiate_baud_rate();
+
+            if(this->compressed_read && !(this->firmware_caps & CAP_RLE_READ)) {
+                *this->console << "Firmware does not support compression; using uncompressed transfers" << std::endl;
+                this->compressed_read = false;
+            }
+        } else {
+            *this->console << "NO REPLY" << std::endl;
+            *this->console << "Falling back to legacy protocol" << std::endl;
+            this->legacy_protocol = true;
+        }
+    }
+
+    if(this->gba_mode) {
+        if(this->legacy_protocol || !(this->firmware_caps & CAP_GBA)) {
+            throw std::runtime_error("Firmware does not support GBA cartridges; flash an image built with BOARD=GBCR_GBA");
+        }
+        if(this->compressed_read) {
+            *this->console << "GBA ROMs are read uncompressed" << std::endl;
+            this->compressed_read = false;
+        }
+    }
+
+    this->read_header();
+}
+
+/**
+ * @brief      read the header of the inserted cartridge; cartridges may be
+ *             swapped while the port stays open
+ */
+void GameboyCartridge::read_header() {
+    if(this->gba_mode) {
+        this->read_gba_header();
+        return;
+    }
+
     // test simple read instruction
-    std::cout << "Test cartridge connectivity..." << std::flush;
-    std::vector<uint8_t> header;
+    *this->console << "Test cartridge connectivity..." << std::flush;
+    this->header.clear();
     this->read_memory(0x0000, 0x0000, &this->header);
-    std::cout << "DONE" << std::endl;
+    *this->console << "DONE" << std::endl;
 
     // read the ROM header and extract valuable information
-    std::cout << "Test reading cartridge header info..." << std::flush;
-    this->read_memory(0x0000, 0x014F, &this->header);
-    std::cout << "DONE" << std::endl;
-    std::cout << "=========================================" << std::endl;
+    *this->console << "Test reading cartridge header info..." << std::flush;
+    this->read_memory(0x0000, 0x0150, &this->header);
+    *this->console << "DONE" << std::endl;
+    *this->console << "=========================================" << std::endl;
     this->print_header_details();
 
-    std::cout << "=========================================" << std::endl;
+    *this->console << "=========================================" << std::endl;
 
     this->cartridge_type = this->header[0x0147];
     this->nrbanks = this->get_number_rom_banks();
 }
 
 /**
- * @brief      load sram into cartridge from file
+ * @brief      measure the number of clock cycles the firmware spends on
+ *             reading a single byte from the cartridge
+ */
+void GameboyCartridge::benchmark() {
+    if(this->legacy_protocol || !(this->firmware_caps & CAP_BENCHMARK)) {
+        throw std::runtime_error("Firmware does not support cycle measurements");
+    }
+
+    char cmd[13];
+    sprintf(cmd, "BNCH0000%04X", this->BENCHMARK_READS);
+    this->write_command_word(cmd);
+
+    char reply[9];
+    if(!this->read_timeout(reply, 8, this->REPLY_TIMEOUT) || strncmp(reply, "CYCL", 4) != 0) {
+        throw std::runtime_error("Invalid reply to cycle measurement");
+    }
+    reply[8] = '\0';
+    const unsigned int cycles = strtoul(&reply[4], NULL, 16);
+
+    *this->console << "Cycles per read_byte(): " << cycles << " (averaged over "
+                   << this->BENCHMARK_READS << " reads)" << std::endl;
+}
+
+/**
+ * @brief      load sram into cartridge from file; when the firmware
+ *             reports block checksums, only the blocks that differ from the
+ *             file are written
  *
  * @param[in]  input_file  Input file
  */
-void GameboyCartridge::load_ram(const std::string& input_file) {
+size_t GameboyCartridge::load_ram(const std::string& input_file) {
+    if(this->gba_mode) {
+        throw std::runtime_error("Save data of GBA cartridges is not supported");
+    }
+
     size_t bytes = 0;
     this->ram_data.clear();
     char c[2];
@@ -69,206 +142,1557 @@ void GameboyCartridge::load_ram(const std::string& input_file) {
     c[1] = '\0';
 
     this->load_from_file(this->ram_data, input_file);
-    std::cout << this->ram_data.size() << std::endl;
+    *this->console << this->ram_data.size() << std::endl;
+
+    const RamLayout layout(this->cartridge_type, this->header[0x149]);
+    const size_t size = layout.get_size();
+    const size_t bank_size = layout.get_bank_size();
 
-    if(this->cartridge_type == 0x13) {
-        size_t size = 4 * 8 * 1024;
-        this->set_ram(true);
+    if(!layout.has_ram()) {
+        *this->console << "Cartridge has no RAM." << std::endl;
+        return 0;
+    }
+
+    if(this->ram_data.size() < size) {
+        throw std::runtime_error("Input file " + input_file + " contains less than " + std::to_string(size) +
+                                 " bytes");
+    }
 
-        for(unsigned int i=0; i<4; i++) {
+    this->set_ram(layout, true);
+
+    for(unsigned int i=0; i<layout.get_banks(); i++) {
+        if(layout.get_banks() > 1) {
             this->change_ram_bank(i);
+        }
+        const size_t offset = i * bank_size;
+
+        // the upper four bits of MBC2 RAM cannot be verified by reading back
+        if(this->has_block_crc() && !layout.is_nibble()) {
+            const auto changed = this->changed_blocks(0xA000, bank_size, &this->ram_data[offset]);
+            size_t changed_bytes = 0;
+            for(const auto& block : changed) {
+                this->write_memory(0xA000 + block.first, &this->ram_data[offset + block.first],
+                                   block.second, false);
+                changed_bytes += block.second;
+            }
+            bytes += changed_bytes;
+            *this->console << "Bank " << i << ": " << changed_bytes / this->CRC_BLOCK_SIZE << " of "
+                           << bank_size / this->CRC_BLOCK_SIZE << " blocks changed" << std::endl;
+            continue;
+        }
+
+        if(!this->legacy_protocol && !layout.is_nibble()) {
+            bytes += this->write_memory(0xA000, &this->ram_data[offset], bank_size, true);
+            *this->console << std::endl;
+            continue;
+        }
+
+        // give instruction that payload is coming
+        char cmd[13] = {'W', 'R', 'I', 'T', 'E', 'R', 'A', 'M', 'X', 'X', 'X', 'X','0'};
+        sprintf(&cmd[8], "%04X", (unsigned int)bank_size);
+        write_command_word(cmd);
+
+        // deliver payload
+        for(uint16_t j = 0; j<bank_size; j++) {
+            c[0] = this->ram_data[offset + j];
+
+            boost::asio::write(port, boost::asio::buffer(&c[0], 1));
+            this->receive(&rec, 1);
+
+            if(c[0] != rec[0]) {
+                std::cerr << "Send: " << c[0] << " | Receive: " << rec[0] << "| i=" << offset + j << std::endl;
+                throw std::runtime_error("An error occurred during data transfer");
+            }
+
+            bytes++;
+            print_loadbar(offset + j + 1, size);
+        }
+
+        *this->console << std::endl;
+    }
+
+    this->set_ram(layout, false);
+
+    *this->console << bytes << " bytes loaded into cartridge." << std::endl;
+    this->print_transfer_summary();
+
+    return bytes;
+}
+
+/**
+ * @brief      read sram from cartridge; when the output file holds an
+ *             earlier backup and the firmware reports block checksums, only
+ *             the blocks that differ from that backup are read
+ *
+ * @param[in]  output_file  The output file
+ */
+size_t GameboyCartridge::read_ram(const std::string& output_file) {
+    if(this->gba_mode) {
+        throw std::runtime_error("Save data of GBA cartridges is not supported");
+    }
+
+    size_t bytes = 0;
+    this->ram_data.clear();
+    auto start = std::chrono::system_clock::now();
+
+    const RamLayout layout(this->cartridge_type, this->header[0x149]);
+    const size_t bank_size = layout.get_bank_size();
+
+    if(layout.has_ram()) {
+        // the undefined upper bits of MBC2 RAM differ on every read
+        std::vector<uint8_t> previous;
+        if(this->has_block_crc() && !layout.is_nibble()) {
+            this->load_from_file(previous, output_file);
+        }
+        const bool incremental = previous.size() == layout.get_size();
+
+        this->set_ram(layout, true);
+
+        for(unsigned int i=0; i<layout.get_banks(); i++) {
+            if(layout.get_banks() > 1) {
+                this->change_ram_bank(i);
+            }
+
+            if(incremental) {
+                const size_t offset = i * bank_size;
+                this->ram_data.insert(this->ram_data.end(), previous.begin() + offset,
+                                      previous.begin() + offset + bank_size);
+                const auto changed = this->changed_blocks(0xA000, bank_size, &this->ram_data[offset]);
+                size_t changed_bytes = 0;
+                for(const auto& block : changed) {
+                    this->read_verified(0xA000 + block.first, block.second,
+                                        &this->ram_data[offset + block.first], false);
+                    changed_bytes += block.second;
+                }
+                bytes += changed_bytes;
+                *this->console << "Bank " << i << ": " << changed_bytes / this->CRC_BLOCK_SIZE << " of "
+                               << bank_size / this->CRC_BLOCK_SIZE << " blocks changed" << std::endl;
+                continue;
+            }
+
+            bytes += this->read_memory(0xA000, bank_size, &this->ram_data, true);
+            *this->console << std::endl;
+        }
+
+        this->set_ram(layout, false);
+
+        if(layout.is_nibble()) {
+            for(auto& value : this->ram_data) {
+                value |= 0xF0;
+            }
+        }
+    } else {
+        *this->console << "Cartridge has no RAM." << std::endl;
+    }
+
+    // calculate time
+    auto end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+
+    // write ram to file
+    this->write_to_file(this->ram_data, output_file);
+
+    *this->console << "Done reading " << bytes << " bytes from RAM in " << elapsed_seconds.count() << " seconds." << std::endl;
+    this->print_transfer_summary();
+
+    return bytes;
+}
+
+/**
+ * @brief      read rom from cartridge
+ *
+ * @param[in]  output_file  The output file
+ */
+size_t GameboyCartridge::read_rom(const std::string& output_file) {
+    if(this->gba_mode) {
+        return this->read_gba_rom(output_file);
+    }
+
+    size_t bytes = 0;
+    auto start = std::chrono::system_clock::now();
+
+    const size_t banks = this->cartridge_type == 0x00 ? 2 : this->nrbanks;
+    const size_t size = banks * this->ROM_BANK_SIZE;
+
+    // the journal identifies the cartridge by its header and global checksum
+    const uint16_t header_crc = crc16(&this->header[0x100], 0x50);
+    const uint16_t checksum = (this->header[0x14E] << 8) | this->header[0x14F];
+    DumpJournal journal(output_file + ".journal");
+    if(this->resume && !journal.load(header_crc, checksum, size)) {
+        throw std::runtime_error("No journal of this cartridge found for " + output_file + "; cannot resume");
+    }
+
+    // the output file is preallocated to the size in the header and every
+    // bank is written to its final offset as soon as it has been received
+    RomWriter out(output_file, size, this->resume);
+
+    // both checksums of the header are verified as the data arrives
+    RomVerifier verifier(banks);
+    this->dat_match.clear();
+
+    if(this->resume) {
+        // only keep the banks that are still intact on disk
+        std::map<size_t, uint16_t> complete;
+        std::vector<uint8_t> data(this->ROM_BANK_SIZE);
+        for(const auto& bank : journal.get_banks()) {
+            if(bank.first < banks && out.read(bank.first * this->ROM_BANK_SIZE, data.data(), data.size()) &&
+               crc16(data.data(), data.size()) == bank.second) {
+                complete.insert(bank);
+                verifier.update(data.data(), bank.first * this->ROM_BANK_SIZE, data.size());
+            }
+        }
+        journal.restart(header_crc, checksum, size, complete);
+        *this->console << "Resuming dump: " << complete.size() << " of " << banks << " banks are complete" << std::endl;
+
+        for(size_t i=0; i<banks; i++) {
+            if(complete.find(i) == complete.end()) {
+                bytes += this->read_bank(i, &out, &journal, &verifier);
+            }
+        }
+    } else if(!this->legacy_protocol && !this->compressed_read && (this->firmware_caps & CAP_DUMP)) {
+        // let the firmware switch the banks and stream the complete ROM
+        journal.start(header_crc, checksum, size);
+        bytes = this->dump_rom(&out, &journal, &verifier);
+    } else if(this->cartridge_type == 0x00) {
+        // read the complete ROM
+        journal.start(header_crc, checksum, size);
+        std::vector<uint8_t> data;
+        const size_t resent = this->resent_blocks;
+        bytes = this->read_memory(0x0000, 0x8000, &data, true);
+        out.write(0x0000, data.data(), data.size());
+        verifier.update(data.data(), 0x0000, data.size());
+        if(this->resent_blocks > resent) {
+            verifier.mark_retried(0);
+            verifier.mark_retried(1);
+        }
+        *this->console << std::endl;
+        this->print_compression_ratio(bytes);
+    } else {
+        journal.start(header_crc, checksum, size);
+        std::vector<uint8_t> data;
+        for(uint16_t i=1; i<this->nrbanks; i++) {
+            data.clear();
+            const uint16_t addr = this->change_rom_bank(i);
+            const size_t resent = this->resent_blocks;
+            if(i == 1) {
+                // read the first 16kb + the first rom bank (total 32kb)
+                *this->console << "Reading ROM BANKS 0+1... please wait" << std::endl;
+                bytes += this->read_memory(0x0000, 0x8000, &data, true);
+                out.write(0x0000, data.data(), data.size());
+                journal.complete(0, crc16(&data[0], this->ROM_BANK_SIZE));
+                journal.complete(1, crc16(&data[this->ROM_BANK_SIZE], this->ROM_BANK_SIZE));
+                verifier.update(data.data(), 0x0000, data.size());
+                if(this->resent_blocks > resent) {
+                    verifier.mark_retried(0);
+                }
+            } else {
+                *this->console << "Reading ROM BANK " << (int)i << "... please wait" << std::endl;
+                bytes += this->read_memory(addr, 0x4000, &data, true);
+                out.write(i * this->ROM_BANK_SIZE, data.data(), data.size());
+                journal.complete(i, crc16(data.data(), data.size()));
+                verifier.update(data.data(), i * this->ROM_BANK_SIZE, data.size());
+            }
+            if(this->resent_blocks > resent) {
+                verifier.mark_retried(i);
+            }
+            *this->console << std::endl;
+            this->print_compression_ratio(i == 1 ? 0x8000 : 0x4000);
+        }
+    }
+    out.sync();
+
+    // the dump is complete, hence the journal is no longer needed
+    journal.remove();
+
+    // calculate time
+    auto end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+
+    *this->console << "Done reading " << bytes << " bytes from ROM in " << elapsed_seconds.count() << " seconds." << std::endl;
+    this->print_transfer_summary();
+
+    // the file is kept, such that a failed dump can be inspected
+    *this->console << verifier.report() << std::endl;
+    if(this->dat != nullptr) {
+        const RomHashes hashes = verifier.finish_hashes(out);
+        this->print_dat_match(hashes);
+    }
+    if(!verifier.header_valid() || !verifier.global_valid()) {
+        throw ChecksumError("Checksum mismatch in " + output_file);
+    }
+
+    return bytes;
+}
+
+/**
+ * @brief      print the hashes of a dump and the game it matches in the DAT
+ *             file
+ *
+ * @param[in]  hashes  hashes of the dump
+ */
+void GameboyCartridge::print_dat_match(const RomHashes& hashes) {
+    std::stringstream msg;
+    msg << "CRC32: " << std::hex << std::setw(8) << std::setfill('0') << hashes.crc32
+        << "  MD5: " << hashes.md5 << "  SHA-1: " << hashes.sha1;
+    *this->console << msg.str() << std::endl;
+
+    if(this->dat->lookup(hashes, &this->dat_match)) {
+        *this->console << "DAT match: " << this->dat_match << std::endl;
+    } else {
+        this->dat_match.clear();
+        *this->console << "No match in DAT" << std::endl;
+    }
+}
+
+/**
+ * @brief      read a single ROM bank, store it and record it in the journal
+ *
+ * @param[in]  bank      bank number
+ * @param      out       output file
+ * @param      journal   journal of the dump
+ * @param      verifier  checksums of the dump
+ *
+ * @return     number of bytes read
+ */
+size_t GameboyCartridge::read_bank(size_t bank, RomWriter* out, DumpJournal* journal, RomVerifier* verifier) {
+    const uint16_t addr = this->change_rom_bank(bank);
+
+    *this->console << "Reading ROM BANK " << bank << "... please wait" << std::endl;
+    std::vector<uint8_t> data;
+    const size_t resent = this->resent_blocks;
+    const size_t bytes = this->read_memory(addr, this->ROM_BANK_SIZE, &data, true);
+    *this->console << std::endl;
+
+    out->write(bank * this->ROM_BANK_SIZE, data.data(), data.size());
+    journal->complete(bank, crc16(data.data(), data.size()));
+    verifier->update(data.data(), bank * this->ROM_BANK_SIZE, data.size());
+    if(this->resent_blocks > resent) {
+        verifier->mark_retried(bank);
+    }
+
+    return bytes;
+}
+
+/**
+ * @brief      compare randomly chosen blocks of the cartridge with an earlier
+ *             dump
+ *
+ * @param[in]  path  path to the dump
+ *
+ * @return     whether the size and all blocks match
+ */
+bool GameboyCartridge::verify_rom(const std::string& path) {
+    const size_t banks = this->cartridge_type == 0x00 ? 2 : this->nrbanks;
+
+    std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+    if(banks < 2 || !in || (size_t)in.tellg() != banks * this->ROM_BANK_SIZE) {
+        return false;
+    }
+
+    // always include the first and last bank, the others are chosen at random
+    std::mt19937 rng(std::random_device{}());
+    std::vector<size_t> sampled(banks);
+    std::iota(sampled.begin(), sampled.end(), 0);
+    std::shuffle(sampled.begin() + 1, sampled.end() - 1, rng);
+    sampled.resize(std::min<size_t>(banks, this->VERIFY_BANKS));
+    sampled.back() = banks - 1;
+    std::sort(sampled.begin(), sampled.end());
+
+    *this->console << "Verifying " << sampled.size() << " banks against earlier dump..." << std::endl;
+    std::uniform_int_distribution<size_t> offsets(0, (this->ROM_BANK_SIZE - this->VERIFY_SAMPLE) / this->VERIFY_SAMPLE);
+    for(size_t bank : sampled) {
+        const size_t bank_offset = offsets(rng) * this->VERIFY_SAMPLE;
+
+        const uint16_t addr = this->change_rom_bank(bank) + bank_offset;
+
+        std::vector<uint8_t> data;
+        this->read_memory(addr, this->VERIFY_SAMPLE, &data);
+
+        std::vector<uint8_t> stored(this->VERIFY_SAMPLE);
+        in.seekg(bank * this->ROM_BANK_SIZE + bank_offset);
+        in.read((char*)stored.data(), stored.size());
+        if(!in || data != stored) {
+            *this->console << "ROM BANK " << bank << " differs from earlier dump" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief      Destroys the object.
+ */
+GameboyCartridge::~GameboyCartridge() {
+    this->port.close();
+}
+
+/**
+ * @brief      writes a command word to ATMEGA
+ *
+ * @param[in]  cmd   command word
+ *
+ */
+void GameboyCartridge::write_command_word(const char* cmd) {
+    if(!this->legacy_protocol) {
+        this->write_command_words({std::string(cmd, 12)});
+        return;
+    }
+
+    char c[12]; // create buffer
+
+    for(unsigned int i=0; i<12; i++) {
+        boost::asio::write(port, boost::asio::buffer(&cmd[i], 1));
+        this->receive(&c, 1);
+        if(cmd[i] != c[0]) {
+            std::cerr << "Send: " << cmd[i] << " | Receive: " << c[0] << "| i=" << i << std::endl;
+            throw std::runtime_error("An error occurred during data transfer");
+        }
+    }
+}
+
+/**
+ * @brief      writes a series of command words to ATMEGA in a single
+ *             transfer and collect their acknowledgements afterwards
+ *
+ * @param[in]  cmds  command words
+ */
+void GameboyCartridge::write_command_words(const std::vector<std::string>& cmds) {
+    if(this->legacy_protocol) {
+        for(const auto& cmd : cmds) {
+            this->write_command_word(cmd.c_str());
+        }
+        return;
+    }
+
+    size_t first = 0;
+    for(unsigned int attempt=0; first < cmds.size(); attempt++) {
+        if(attempt > this->MAX_RETRIES) {
+            throw std::runtime_error("Command " + cmds[first].substr(0, 12) + " was not acknowledged");
+        }
+
+        std::vector<uint8_t> frames;
+        for(size_t i=first; i<cmds.size(); i++) {
+            this->append_command_frame(&frames, cmds[i].c_str());
+        }
+        boost::asio::write(port, boost::asio::buffer(frames));
+
+        // every command is acknowledged by CMD_FRAME and a CRC-8 checksum
+        size_t i = first;
+        for(; i<cmds.size(); i++) {
+            uint8_t ack[2];
+            const uint8_t crc = crc8((const uint8_t*)cmds[i].c_str(), 12);
+            if(!this->read_timeout(ack, 2, this->REPLY_TIMEOUT) ||
+               ack[0] != (uint8_t)this->CMD_FRAME || ack[1] != crc) {
+                break;
+            }
+        }
+
+        // resend all commands from the first one that was not acknowledged
+        if(i < cmds.size()) {
+            this->resent_commands += cmds.size() - i;
+            this->resync();
+        }
+        first = i;
+    }
+}
+
+/**
+ * @brief      append a framed command to a transfer buffer
+ *
+ * @param      frames  transfer buffer
+ * @param[in]  cmd     command word
+ */
+void GameboyCartridge::append_command_frame(std::vector<uint8_t>* frames, const char* cmd) const {
+    frames->push_back(this->CMD_FRAME);
+    frames->insert(frames->end(), cmd, cmd + 12);
+    if(this->firmware_caps & CAP_CRC) {
+        frames->push_back(crc8((const uint8_t*)cmd, 12));
+    }
+}
+
+/**
+ * @brief      wait until the link is idle and discard all received data
+ */
+void GameboyCartridge::resync() {
+    tcdrain(this->port.native_handle());
+
+    int waiting = 0;
+    do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(this->RESYNC_IDLE));
+        ioctl(this->port.native_handle(), FIONREAD, &waiting);
+        this->flush_input();
+    } while(waiting > 0);
+}
+
+/**
+ * @brief      read from the serial port, giving up after a timeout
+ *
+ * @param      data        pointer to buffer
+ * @param[in]  len         number of bytes to read
+ * @param[in]  timeout_ms  timeout in milliseconds
+ *
+ * @return     whether all bytes were received in time
+ */
+bool GameboyCartridge::read_timeout(void* data, size_t len, unsigned int timeout_ms) {
+    if(!this->fill_rx_buffer(len, timeout_ms)) {
+        return false;
+    }
+
+    memcpy(data, &this->rx_buffer[this->rx_begin], len);
+    this->rx_begin += len;
+
+    return true;
+}
+
+/**
+ * @brief      read from the serial port and throw when no data arrives
+ *             within REPLY_TIMEOUT
+ *
+ * @param      data  pointer to buffer
+ * @param[in]  len   number of bytes to read
+ */
+void GameboyCartridge::receive(void* data, size_t len) {
+    if(!this->read_timeout(data, len, this->REPLY_TIMEOUT)) {
+        throw std::runtime_error("Timeout while waiting for data");
+    }
+}
+
+/**
+ * @brief      make sure the receive buffer holds at least len bytes,
+ *             giving up after a timeout
+ *
+ * @param[in]  len         number of bytes
+ * @param[in]  timeout_ms  timeout in milliseconds
+ *
+ * @return     whether the bytes were received in time
+ */
+bool GameboyCartridge::fill_rx_buffer(size_t len, unsigned int timeout_ms) {
+    if(this->rx_end - this->rx_begin >= len) {
+        return true;
+    }
+
+    // move the unconsumed bytes to the front to make room at the end
+    if(this->rx_begin > 0) {
+        memmove(&this->rx_buffer[0], &this->rx_buffer[this->rx_begin], this->rx_end - this->rx_begin);
+        this->rx_end -= this->rx_begin;
+        this->rx_begin = 0;
+    }
+
+    bool timer_done = false;
+    boost::asio::deadline_timer timer(this->io);
+    timer.expires_from_now(boost::posix_time::milliseconds(timeout_ms));
+    timer.async_wait([&](const boost::system::error_code&) {
+        timer_done = true;
+    });
+
+    // every read returns whatever the driver has received so far
+    while(this->rx_end < len && !timer_done) {
+        bool read_done = false;
+        boost::system::error_code read_ec;
+        port.async_read_some(boost::asio::buffer(&this->rx_buffer[this->rx_end],
+                                                 this->rx_buffer.size() - this->rx_end),
+                             [&](const boost::system::error_code& ec, size_t n) {
+            read_ec = ec;
+            this->rx_end += n;
+            this->rx_bytes += n;
+            read_done = true;
+        });
+
+        // run until the read completes or the timer expires, in which case
+        // the read is cancelled and its handler still runs
+        this->io.reset();
+        while(!read_done && this->io.run_one()) {
+            if(timer_done && !read_done) {
+                port.cancel();
+            }
+        }
+        this->rx_reads++;
+
+        if(read_ec && read_ec != boost::asio::error::operation_aborted) {
+            break;
+        }
+    }
+
+    timer.cancel();
+    this->io.reset();
+    this->io.poll();
+
+    return this->rx_end >= len;
+}
+
+/**
+ * @brief      discard any data that is waiting in the receive queue
+ */
+void GameboyCartridge::flush_input() {
+    tcflush(this->port.native_handle(), TCIFLUSH);
+    this->rx_begin = 0;
+    this->rx_end = 0;
+}
+
+/**
+ * @brief      query firmware version, capabilities and baud rates
+ *
+ * @param[in]  framed  whether to send HELO as a framed command
+ *
+ * @return     whether the firmware replied
+ */
+bool GameboyCartridge::query_hello(bool framed) {
+    const char cmd[13] = "HELO00000000";
+
+    if(framed) {
+        uint8_t ack[2];
+        std::vector<uint8_t> frame;
+        this->append_command_frame(&frame, cmd);
+        boost::asio::write(port, boost::asio::buffer(frame));
+        if(!this->read_timeout(ack, 2, 1000) || ack[0] != (uint8_t)this->CMD_FRAME ||
+           ack[1] != crc8((const uint8_t*)cmd, 12)) {
+            return false;
+        }
+    } else {
+        // older firmware echoes every character, but does not reply to HELO
+        for(unsigned int i=0; i<12; i++) {
+            char c;
+            boost::asio::write(port, boost::asio::buffer(&cmd[i], 1));
+            if(!this->read_timeout(&c, 1, 1000) || c != cmd[i]) {
+                return false;
+            }
+        }
+    }
+
+    char reply[25];
+    if(!this->read_timeout(reply, 24, 1000)) {
+        return false;
+    }
+    reply[24] = '\0';
+
+    if(strncmp(&reply[0], "VERS", 4) != 0 || strncmp(&reply[8], "CAPS", 4) != 0 ||
+       strncmp(&reply[16], "BAUD", 4) != 0) {
+        return false;
+    }
+
+    this->firmware_baud_rates = strtoul(&reply[20], NULL, 16);
+    reply[16] = '\0';
+    this->firmware_caps = strtoul(&reply[12], NULL, 16);
+    reply[8] = '\0';
+    this->firmware_version = strtoul(&reply[4], NULL, 16);
+
+    return true;
+}
+
+/**
+ * @brief      switch both ends to the fastest baud rate that passes the
+ *             link test
+ */
+void GameboyCartridge::negotiate_baud_rate() {
+    if(!(this->firmware_caps & CAP_BAUD_SWITCH)) {
+        return;
+    }
+
+    for(int i=this->BAUD_RATES.size()-1; i>0; i--) {
+        if(!(this->firmware_baud_rates & (1 << i)) || this->BAUD_RATES[i] > this->max_baud_rate) {
+            continue;
+        }
+
+        *this->console << "Testing link at " << this->BAUD_RATES[i] << " baud..." << std::flush;
+        if(this->switch_baud_rate(i)) {
+            *this->console << "DONE" << std::endl;
+            return;
+        }
+        *this->console << "FAILED" << std::endl;
+    }
+}
+
+/**
+ * @brief      switch both ends to another baud rate and test the link
+ *
+ * @param[in]  idx   index of the baud rate in BAUD_RATES
+ *
+ * @return     whether the link works at the new baud rate
+ */
+bool GameboyCartridge::switch_baud_rate(unsigned int idx) {
+    const size_t prev = this->baud_rate;
+
+    char cmd[13];
+    sprintf(cmd, "BAUD%04X%04X", 0, idx);
+    this->write_command_word(cmd);
+
+    char reply[9];
+    char expected[9];
+    sprintf(expected, "BAUD%04X", idx);
+    if(!this->read_timeout(reply, 8, 1000) || strncmp(reply, expected, 8) != 0) {
+        return false;
+    }
+
+    // send the test pattern at the new rate, which should be echoed, and
+    // confirm with the inverted pattern
+    this->set_port_baud_rate(this->BAUD_RATES[idx]);
+    std::vector<uint8_t> pattern = this->BAUD_TEST_PATTERN;
+    std::vector<uint8_t> echo(pattern.size());
+    boost::asio::write(port, boost::asio::buffer(pattern));
+
+    if(this->read_timeout(&echo[0], echo.size(), this->BAUD_TEST_TIMEOUT) && echo == pattern) {
+        for(auto& v : pattern) {
+            v = ~v;
+        }
+        boost::asio::write(port, boost::asio::buffer(pattern));
+
+        if(this->query_hello(true)) {
+            return true;
+        }
+    }
+
+    // the firmware falls back to the previous rate once its test times out
+    std::this_thread::sleep_for(std::chrono::milliseconds(4 * this->BAUD_TEST_TIMEOUT));
+    this->set_port_baud_rate(prev);
+    this->flush_input();
+
+    if(!this->query_hello(true)) {
+        throw std::runtime_error("Lost connection while negotiating baud rate");
+    }
+
+    return false;
+}
+
+/**
+ * @brief      set the baud rate of the host end of the link
+ *
+ * @param[in]  baud  baud rate
+ */
+void GameboyCartridge::set_port_baud_rate(size_t baud) {
+    this->port.set_option(boost::asio::serial_port_base::baud_rate(baud));
+    this->baud_rate = baud;
+}
+
+/**
+ * @brief      enables or disables access to the RAM
+ *
+ * @param[in]  layout  layout of the RAM
+ * @param[in]  enable  whether to enable or disable
+ */
+void GameboyCartridge::set_ram(const RamLayout& layout, bool enable) {
+    if(!layout.needs_enable()) {
+        return;
+    }
+
+    if(enable) {
+        *this->console << "Enable RAM BANK" << std::endl;
+    } else {
+        *this->console << "Disable RAM BANK" << std::endl;
+    }
+
+    char cmd[13] = {'W', 'R', 'B', 'Y', '0', '0', '0', '0', 'X', 'X', 'X', 'X','0'};
+    std::vector<std::string> cmds;
+
+    sprintf(&cmd[4], "%04X%04X", 0x0000, enable ? 0x0A : 0x00);
+    cmds.emplace_back(cmd, 12);
+
+    // MBC1 only switches RAM banks in RAM banking mode; ROM banking mode
+    // is restored afterwards
+    if(layout.get_controller() == RamLayout::RAM_MBC1 && layout.get_banks() > 1) {
+        sprintf(&cmd[4], "%04X%04X", 0x6000, enable ? 0x01 : 0x00);
+        cmds.emplace_back(cmd, 12);
+    }
+
+    this->write_command_words(cmds);
+}
+
+/**
+ * @brief      change ram bank number
+ *
+ * @param[in]  bank_addr  ram bank number
+ */
+void GameboyCartridge::change_ram_bank(uint8_t bank_addr) {
+    *this->console << "Changing to RAM BANK: " << (int)bank_addr << "  " << std::endl;
+
+    char cmd[13] = {'W', 'R', 'B', 'Y', '0', '0', '0', '0', 'X', 'X', 'X', 'X','0'};
+
+    sprintf(&cmd[4], "%04X%04X", 0x4000, bank_addr);
+    this->write_command_word(cmd);
+}
+
+/**
+ * @brief      change rom bank number
+ *
+ * MBC1 maps a zero in the lower five bits of the bank number to one, such
+ * that banks 0x20, 0x40 and 0x60 cannot be mapped at 0x4000 - 0x7FFF; in RAM
+ * banking mode, these banks (and bank 0) appear at 0x0000 - 0x3FFF instead.
+ *
+ * @param[in]  bank_addr  rom bank number
+ *
+ * @return     address at which the bank is visible
+ */
+uint16_t GameboyCartridge::change_rom_bank(uint16_t bank_addr) {
+    if(this->cartridge_type == 0x00) {
+        // without a controller, bank 1 is always visible at 0x4000
+        return bank_addr > 0 ? this->ROM_BANK_SIZE : 0x0000;
+    }
+
+    *this->console << "Changing to ROM BANK: " << bank_addr << "  " << std::endl;
+
+    char cmd[13] = {'W', 'R', 'B', 'Y', '0', '0', '0', '0', 'X', 'X', 'X', 'X','0'};
+
+    if(this->cartridge_type <= 0x03 && (bank_addr & 0x1F) == 0) {
+        // MBC1: RAM banking mode and the upper bits, in a single transfer
+        std::vector<std::string> cmds;
+        sprintf(&cmd[4], "%04X%04X", 0x6000, 0x01);
+        cmds.emplace_back(cmd, 12);
+        sprintf(&cmd[4], "%04X%04X", 0x4000, (bank_addr >> 5) & 0x03);
+        cmds.emplace_back(cmd, 12);
+        this->write_command_words(cmds);
+        return 0x0000;
+    }
+
+    if(bank_addr == 0) {
+        return 0x0000;
+    }
+
+    if(this->cartridge_type >= 0x19 && this->cartridge_type <= 0x1E) {
+        // MBC5: lower 8 bits and bit 8 of the bank number, in a single transfer
+        std::vector<std::string> cmds;
+        sprintf(&cmd[4], "%04X%04X", 0x2100, bank_addr & 0xFF);
+        cmds.emplace_back(cmd, 12);
+        sprintf(&cmd[4], "%04X%04X", 0x3000, (bank_addr >> 8) & 0x01);
+        cmds.emplace_back(cmd, 12);
+        this->write_command_words(cmds);
+    } else if(this->cartridge_type >= 5) {
+        sprintf(&cmd[4], "%04X%04X", 0x2100, bank_addr & 0xFF);
+        this->write_command_word(cmd);
+    } else {
+        // submit all three register writes in a single transfer
+        std::vector<std::string> cmds;
+        sprintf(&cmd[4], "%04X%04X", 0x6000, 0x00);
+        cmds.emplace_back(cmd, 12);
+        sprintf(&cmd[4], "%04X%04X", 0x4000, (bank_addr >> 5) & 0x03);
+        cmds.emplace_back(cmd, 12);
+        sprintf(&cmd[4], "%04X%04X", 0x2100, bank_addr & 0x1F);
+        cmds.emplace_back(cmd, 12);
+        this->write_command_words(cmds);
+    }
+
+    return this->ROM_BANK_SIZE;
+}
 
-            // give instruction that payload is coming
-            char cmd[13] = {'W', 'R', 'I', 'T', 'E', 'R', 'A', 'M', 'X', 'X', 'X', 'X','0'};
-            sprintf(&cmd[8], "%04X", 0x2000);
-            write_command_word(cmd);
+/*
+ * @brief      read_memory
+ *
+ * @param      _addr          starting address
+ * @param      _len           number of bytes to read
+ * @param      buffer         pointer to vector to store data
+ * @param[in]  show_progress  The show progress
+ *
+ * @return     number of bytes read
+ */
+size_t GameboyCartridge::read_memory(uint16_t _addr, uint16_t _len, std::vector<uint8_t> *buffer, bool show_progress) {
+    if(this->legacy_protocol) {
+        return this->read_memory_hex(_addr, _len, buffer, show_progress);
+    }
+
+    const size_t base = buffer->size();
+    buffer->resize(base + _len);
+    this->encoded_bytes = 0;
+
+    this->read_verified(_addr, _len, buffer->data() + base, show_progress);
+
+    return _len;
+}
+
+/*
+ * @brief      read a range of memory in binary frames and request the blocks
+ *             that failed once more
+ *
+ * @param[in]  _addr          starting address
+ * @param[in]  _len           number of bytes to read
+ * @param      dst            pointer to output buffer
+ * @param[in]  show_progress  whether to show a progress bar
+ */
+void GameboyCartridge::read_verified(uint16_t _addr, uint16_t _len, uint8_t* dst, bool show_progress) {
+    // blocks that failed are listed as (offset, length)
+    std::vector<std::pair<size_t, size_t>> failed;
+    this->read_frames(_addr, _len, dst, &failed, show_progress);
+
+    // request only the failed blocks once more; only rounds that do not
+    // reduce the number of failed bytes count as a failed attempt
+    size_t prev_failed = _len + 1;
+    for(unsigned int attempt=0; !failed.empty(); attempt++) {
+        size_t failed_bytes = 0;
+        for(const auto& block : failed) {
+            failed_bytes += block.second;
+        }
+        if(failed_bytes < prev_failed) {
+            attempt = 0;
+        }
+        prev_failed = failed_bytes;
+
+        if(attempt > this->MAX_RETRIES) {
+            std::stringstream msg;
+            msg << "Could not receive data at 0x" << std::hex << std::setw(4) << std::setfill('0')
+                << (_addr + failed.front().first);
+            throw std::runtime_error(msg.str());
+        }
+
+        std::vector<std::pair<size_t, size_t>> again;
+        for(const auto& block : failed) {
+            std::vector<std::pair<size_t, size_t>> block_failed;
+            this->resent_blocks++;
+            this->resent_bytes += block.second;
+            this->read_frames(_addr + block.first, block.second, dst + block.first, &block_failed, false);
+            for(const auto& b : block_failed) {
+                again.emplace_back(block.first + b.first, b.second);
+            }
+        }
+        failed.swap(again);
+    }
+}
+
+/**
+ * @brief      whether the firmware can report checksums of memory blocks,
+ *             such that only blocks that changed are transferred
+ *
+ * @return     whether incremental transfers are available
+ */
+bool GameboyCartridge::has_block_crc() const {
+    return !this->legacy_protocol && (this->firmware_caps & CAP_BLOCK_CRC);
+}
+
+/**
+ * @brief      let the firmware compute the CRC-16 of every block of
+ *             CRC_BLOCK_SIZE bytes in a range of memory
+ *
+ * @param[in]  _addr  starting address
+ * @param[in]  _len   number of bytes
+ *
+ * @return     checksum of every block
+ */
+std::vector<uint16_t> GameboyCartridge::read_block_crcs(uint16_t _addr, uint16_t _len) {
+    const size_t nrblocks = (_len + this->CRC_BLOCK_SIZE - 1) / this->CRC_BLOCK_SIZE;
+
+    // the firmware reads every byte of the range before the last checksum
+    // is sent, which takes about 32 us per byte
+    const unsigned int timeout = this->REPLY_TIMEOUT + _len / 32;
+
+    char cmd[13];
+    sprintf(cmd, "BCRC%04X%04X", _addr, _len);
+
+    for(unsigned int attempt=0; attempt <= this->MAX_RETRIES; attempt++) {
+        if(attempt > 0) {
+            this->resync();
+            this->resent_commands++;
+        }
+        this->write_command_word(cmd);
+
+        char header[9];
+        if(!this->read_timeout(header, 8, this->REPLY_TIMEOUT) || strncmp(header, "CRCS", 4) != 0) {
+            continue;
+        }
+        header[8] = '\0';
+        if(strtoul(&header[4], NULL, 16) != nrblocks) {
+            continue;
+        }
+
+        // checksums (MSB first) followed by the CRC-16 over these
+        std::vector<uint8_t> reply(nrblocks * 2 + 2);
+        if(!this->read_timeout(reply.data(), reply.size(), timeout)) {
+            continue;
+        }
+        const uint16_t crc = (reply[nrblocks * 2] << 8) | reply[nrblocks * 2 + 1];
+        if(crc16(reply.data(), nrblocks * 2) != crc) {
+            continue;
+        }
+
+        std::vector<uint16_t> crcs(nrblocks);
+        for(size_t i=0; i<nrblocks; i++) {
+            crcs[i] = (reply[i * 2] << 8) | reply[i * 2 + 1];
+        }
+        return crcs;
+    }
+
+    std::stringstream msg;
+    msg << "Could not receive block checksums at 0x" << std::hex << std::setw(4) << std::setfill('0') << _addr;
+    throw std::runtime_error(msg.str());
+}
+
+/**
+ * @brief      compare a range of memory with a copy on the host and collect
+ *             the blocks that differ
+ *
+ * @param[in]  _addr  starting address
+ * @param[in]  _len   number of bytes
+ * @param[in]  data   copy of the memory on the host
+ *
+ * @return     adjacent blocks that differ, merged as (offset, length)
+ */
+std::vector<std::pair<size_t, size_t>> GameboyCartridge::changed_blocks(uint16_t _addr, uint16_t _len,
+                                                                        const uint8_t* data) {
+    const std::vector<uint16_t> crcs = this->read_block_crcs(_addr, _len);
+
+    std::vector<std::pair<size_t, size_t>> changed;
+    for(size_t i=0; i<crcs.size(); i++) {
+        const size_t offset = i * this->CRC_BLOCK_SIZE;
+        const size_t len = std::min(this->CRC_BLOCK_SIZE, _len - offset);
+        if(crc16(data + offset, len) == crcs[i]) {
+            continue;
+        }
+
+        if(!changed.empty() && changed.back().first + changed.back().second == offset) {
+            changed.back().second += len;
+        } else {
+            changed.emplace_back(offset, len);
+        }
+    }
+
+    return changed;
+}
+
+/**
+ * @brief      let the firmware stream all ROM banks in a single transfer and
+ *             request the blocks that failed afterwards; the stream is
+ *             received, decoded and stored by three separate threads
+ *
+ * @param      out       output file
+ * @param      journal   journal of the dump
+ * @param      verifier  checksums of the dump
+ *
+ * @return     number of bytes read
+ */
+size_t GameboyCartridge::dump_rom(RomWriter* out, DumpJournal* journal, RomVerifier* verifier) {
+    const size_t banks = out->get_size() / this->ROM_BANK_SIZE;
+    const size_t total = out->get_size();
+
+    const size_t trailer = (this->firmware_caps & CAP_CRC) ? 2 : 0;
+    const size_t expected_bytes = (total / this->FRAME_SIZE) * (1 + this->FRAME_SIZE + trailer);
+    DumpPipeline pipeline(total, expected_bytes, out, journal, verifier, nullptr, banks);
+
+    *this->console << "Reading " << banks << " ROM BANKS... please wait" << std::endl;
+
+    char cmd[13];
+    sprintf(cmd, "DUMP%04X%04X", this->cartridge_type, (unsigned int)banks);
+    char expected[17];
+    sprintf(expected, "TYPE%04XBNKS%04X", this->cartridge_type, (unsigned int)banks);
+    this->stream_frames(&pipeline, cmd, expected);
+
+    // blocks that failed are listed as (offset, length)
+    std::vector<std::pair<size_t, size_t>> failed = pipeline.failed;
+    if(pipeline.lost_offset < total) {
+        failed.emplace_back(pipeline.lost_offset, total - pipeline.lost_offset);
+    }
+
+    // request the failed blocks bank by bank; the bank that is selected
+    // after the stream is not known
+    size_t selected = this->nrbanks;
+    uint16_t base = 0x0000;
+    for(const auto& block : failed) {
+        size_t offset = block.first;
+        const size_t end = block.first + block.second;
+
+        while(offset < end) {
+            const size_t bank = offset / this->ROM_BANK_SIZE;
+            const size_t bank_offset = offset % this->ROM_BANK_SIZE;
+            const size_t len = std::min(end - offset, this->ROM_BANK_SIZE - bank_offset);
+
+            if(bank != selected) {
+                base = this->change_rom_bank(bank);
+                selected = bank;
+            }
+            const uint16_t addr = base + bank_offset;
+
+            std::vector<uint8_t> data(len);
+            this->resent_blocks++;
+            this->resent_bytes += len;
+            this->read_verified(addr, len, data.data(), false);
+
+            out->write(offset, data.data(), len);
+            verifier->update(data.data(), offset, len);
+            verifier->mark_retried(bank);
+            this->complete_blocks(&pipeline, offset, len);
+
+            offset += len;
+        }
+    }
 
-            // deliver payload
-            for(uint16_t j = 0; j<0x2000; j++) {
-                c[0] = this->ram_data[bytes];
+    if(this->verbose) {
+        this->print_pipeline_statistics(pipeline);
+    }
 
-                boost::asio::write(port, boost::asio::buffer(&c[0], 1));
-                boost::asio::read(port, boost::asio::buffer(&rec,1));
+    return total;
+}
+
+/**
+ * @brief      start a stream of binary frames and run the stages of the
+ *             pipeline until it has been received or can no longer be
+ *             followed
+ *
+ * @param      pipeline  state of the dump
+ * @param[in]  cmd       command that starts the stream
+ * @param[in]  expected  header the firmware replies with (16 chars)
+ */
+void GameboyCartridge::stream_frames(DumpPipeline* pipeline, const char* cmd, const char* expected) {
+    this->write_command_word(cmd);
+
+    char c[17];
+    if(!this->read_timeout(c, 16, this->REPLY_TIMEOUT) || strncmp(c, expected, 16) != 0) {
+        pipeline->lost_offset = 0;
+        this->resync();
+    } else {
+        std::thread reader(&GameboyCartridge::dump_reader, this, pipeline);
+        std::thread decoder(&GameboyCartridge::dump_decoder, this, pipeline);
+        std::thread sink(&GameboyCartridge::dump_sink, this, pipeline);
+        reader.join();
+        decoder.join();
+        sink.join();
+
+        if(pipeline->lost_offset < pipeline->total) {
+            // stop the stream, such that the link becomes idle
+            boost::asio::write(port, boost::asio::buffer(&this->CMD_ABORT, 1));
+            this->resync();
+        }
+    }
+    *this->console << std::endl;
+}
+
+/**
+ * @brief      serial reader stage of a ROM dump: pass everything the driver
+ *             has received on to the decoder
+ *
+ * @param      pipeline  state of the dump
+ */
+void GameboyCartridge::dump_reader(DumpPipeline* pipeline) {
+    const int fd = this->port.native_handle();
+    size_t bytes = 0;
+
+    // data that was received together with the header
+    while(this->rx_begin < this->rx_end) {
+        DumpChunk* chunk = pipeline->chunks.acquire();
+        if(chunk == nullptr) {
+            std::this_thread::sleep_for(std::chrono::microseconds(this->PIPELINE_WAIT));
+            continue;
+        }
+        chunk->len = std::min(this->rx_end - this->rx_begin, sizeof(chunk->data));
+        memcpy(chunk->data, &this->rx_buffer[this->rx_begin], chunk->len);
+        this->rx_begin += chunk->len;
+        bytes += chunk->len;
+        pipeline->chunks.publish();
+    }
+    this->rx_begin = 0;
+    this->rx_end = 0;
+
+    while(bytes < pipeline->expected && !pipeline->abort.load(std::memory_order_relaxed)) {
+        DumpChunk* chunk = pipeline->chunks.acquire();
+        if(chunk == nullptr) {
+            std::this_thread::sleep_for(std::chrono::microseconds(this->PIPELINE_WAIT));
+            continue;
+        }
+
+        // give up when the firmware stops sending
+        pollfd pfd = {fd, POLLIN, 0};
+        if(poll(&pfd, 1, this->REPLY_TIMEOUT) <= 0) {
+            break;
+        }
+
+        const ssize_t n = read(fd, chunk->data, std::min(sizeof(chunk->data), pipeline->expected - bytes));
+        this->rx_reads++;
+        if(n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            continue;
+        }
+        if(n <= 0) {
+            break;
+        }
+
+        chunk->len = n;
+        bytes += n;
+        this->rx_bytes += n;
+        pipeline->chunks.publish();
+    }
+
+    pipeline->reader_done.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief      decoder stage of a ROM dump: split the received data into
+ *             frames, verify them and pass their payload on to the sink
+ *
+ * @param      pipeline  state of the dump
+ */
+void GameboyCartridge::dump_decoder(DumpPipeline* pipeline) {
+    const size_t trailer = (this->firmware_caps & CAP_CRC) ? 2 : 0;
+    const size_t frame_len = 1 + this->FRAME_SIZE + trailer;
+    uint8_t frame[260];
+    size_t have = 0;        // bytes of the current frame that were received
+    size_t offset = 0;      // offset of the current frame in the ROM
+    bool lost = false;
+
+    while(offset < pipeline->total && !lost) {
+        DumpChunk* chunk = pipeline->chunks.peek();
+        if(chunk == nullptr) {
+            if(pipeline->reader_done.load(std::memory_order_acquire) && pipeline->chunks.peek() == nullptr) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(this->PIPELINE_WAIT));
+            continue;
+        }
+
+        const uint8_t* src = chunk->data;
+        size_t n = chunk->len;
+        while(n > 0 && offset < pipeline->total) {
+            // without a valid length byte, the stream can no longer be followed
+            if(have == 0 && src[0] != this->FRAME_SIZE) {
+                lost = true;
+                break;
+            }
 
-                if(c[0] != rec[0]) {
-                    std::cerr << "An error occurred during data transfer, aborting!" << std::endl;
-                    std::cerr << "Error encountered at " << __FILE__ << " (" << __LINE__ << ")" << std::endl;
-                    std::cerr << "Send: " << cmd[i] << " | Receive: " << c[0] << "| i=" << i << std::endl;
-                    exit(-1);
+            // decode complete frames in place, collect partial ones
+            const uint8_t* f = src;
+            if(have > 0 || n < frame_len) {
+                const size_t k = std::min(n, frame_len - have);
+                memcpy(&frame[have], src, k);
+                have += k;
+                src += k;
+                n -= k;
+                if(have < frame_len) {
+                    continue;
                 }
+                f = frame;
+            } else {
+                src += frame_len;
+                n -= frame_len;
+            }
+            have = 0;
+
+            bool valid = true;
+            if(trailer > 0) {
+                const uint16_t crc = (f[this->FRAME_SIZE + 1] << 8) | f[this->FRAME_SIZE + 2];
+                valid = crc16(&f[1], this->FRAME_SIZE) == crc;
+            }
 
-                bytes++;
-                print_loadbar(bytes, size);
+            DumpBlock* block = nullptr;
+            while((block = pipeline->blocks.acquire()) == nullptr) {
+                std::this_thread::sleep_for(std::chrono::microseconds(this->PIPELINE_WAIT));
             }
+            block->offset = offset;
+            block->len = this->FRAME_SIZE;
+            block->valid = valid;
+            memcpy(block->data, &f[1], this->FRAME_SIZE);
+            pipeline->blocks.publish();
 
-            std::cout << std::endl;
+            offset += this->FRAME_SIZE;
         }
+        pipeline->chunks.release();
+    }
+
+    if(offset < pipeline->total) {
+        pipeline->lost_offset = offset;
+        pipeline->abort.store(true, std::memory_order_relaxed);
 
-        this->set_ram(false);
+        // let the reader finish, it might wait for a free slot
+        while(!pipeline->reader_done.load(std::memory_order_acquire)) {
+            if(pipeline->chunks.peek() != nullptr) {
+                pipeline->chunks.release();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(this->PIPELINE_WAIT));
+            }
+        }
     }
 
-    std::cout << bytes << " bytes loaded into cartridge." << std::endl;
+    pipeline->decoder_done.store(true, std::memory_order_release);
 }
 
 /**
- * @brief      read sram from cartridge
+ * @brief      sink stage of a ROM dump: write the verified blocks to disk,
+ *             update the checksums and show the progress
  *
- * @param[in]  output_file  The output file
+ * @param      pipeline  state of the dump
  */
-void GameboyCartridge::read_ram(const std::string& output_file) {
+void GameboyCartridge::dump_sink(DumpPipeline* pipeline) {
     size_t bytes = 0;
-    this->ram_data.clear();
-    auto start = std::chrono::system_clock::now();
-
-    if(this->cartridge_type == 0x13 || this->cartridge_type == 0x1B) {
-        this->set_ram(true);
-
-        for(unsigned int i=0; i<4; i++) {
-            this->change_ram_bank(i);
-            bytes += this->read_memory(0xA000, 0x2000, &this->ram_data, true);
-            std::cout << std::endl;
+    int percentage = -1;
+    const auto start = std::chrono::system_clock::now();
+
+    while(true) {
+        DumpBlock* block = pipeline->blocks.peek();
+        if(block == nullptr) {
+            if(pipeline->decoder_done.load(std::memory_order_acquire) && pipeline->blocks.peek() == nullptr) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(this->PIPELINE_WAIT));
+            continue;
         }
 
-        this->set_ram(false);
-    }
-
-    // calculate time
-    auto end = std::chrono::system_clock::now();
-    std::chrono::duration<double> elapsed_seconds = end-start;
+        if(block->valid) {
+            pipeline->out->write(block->offset, block->data, block->len);
+            if(pipeline->verifier != nullptr) {
+                pipeline->verifier->update(block->data, block->offset, block->len);
+            }
+            if(pipeline->hasher != nullptr) {
+                pipeline->hasher->update(block->data, block->offset, block->len);
+            }
+            this->complete_blocks(pipeline, block->offset, block->len);
+        } else {
+            pipeline->failed.emplace_back(block->offset, block->len);
+        }
 
-    // write ram to file
-    this->write_to_file(this->ram_data, output_file);
+        bytes += block->len;
+        pipeline->blocks.release();
 
-    std::cout << "Done reading " << bytes << " bytes from RAM in " << elapsed_seconds.count() << " seconds." << std::endl;
+        // redraw once per percent
+        if((int)(bytes * 100 / pipeline->total) != percentage) {
+            percentage = bytes * 100 / pipeline->total;
+            std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+            this->print_progress(bytes, pipeline->total, elapsed.count());
+        }
+    }
 }
 
 /**
- * @brief      read rom from cartridge
+ * @brief      account for stored blocks and record every bank that is
+ *             complete in the journal
  *
- * @param[in]  output_file  The output file
+ * @param      pipeline  state of the dump
+ * @param[in]  offset    offset of the blocks in the ROM
+ * @param[in]  len       number of bytes
  */
-void GameboyCartridge::read_rom(const std::string& output_file) {
-    size_t bytes = 0;
-    auto start = std::chrono::system_clock::now();
+void GameboyCartridge::complete_blocks(DumpPipeline* pipeline, size_t offset, size_t len) {
+    if(pipeline->journal == nullptr) {
+        return;
+    }
 
-    if(this->cartridge_type == 0x00) {
-        // read the complete ROM
-        size_t bytes = this->read_memory(0x0000, 0x8000, &this->rom_data, true);
-    } else {
-        for(uint8_t i=1; i<this->nrbanks; i++) {
-            this->change_rom_bank(i); // false suppress output
-            if(i == 1) {
-                // read the first 16kb + the first rom bank (total 32kb)
-                std::cout << "Reading ROM BANKS 0+1... please wait" << std::endl;
-                bytes += this->read_memory(0x0000, 0x8000, &this->rom_data, true);
-            } else {
-                std::cout << "Reading ROM BANK " << (int)i << "... please wait" << std::endl;
-                bytes += this->read_memory(0x4000, 0x4000, &this->rom_data, true);
+    while(len > 0) {
+        const size_t bank = offset / this->ROM_BANK_SIZE;
+        const size_t n = std::min(len, (bank + 1) * this->ROM_BANK_SIZE - offset);
+
+        pipeline->bank_bytes[bank] += n;
+        if(pipeline->bank_bytes[bank] == this->ROM_BANK_SIZE) {
+            std::vector<uint8_t> data(this->ROM_BANK_SIZE);
+            if(pipeline->out->read(bank * this->ROM_BANK_SIZE, data.data(), data.size())) {
+                pipeline->journal->complete(bank, crc16(data.data(), data.size()));
             }
-            std::cout << std::endl;
         }
-    }
-
-    // calculate time
-    auto end = std::chrono::system_clock::now();
-    std::chrono::duration<double> elapsed_seconds = end-start;
 
-    // write rom to file
-    this->write_to_file(this->rom_data, output_file);
+        offset += n;
+        len -= n;
+    }
+}
 
-    std::cout << "Done reading " << bytes << " bytes from ROM in " << elapsed_seconds.count() << " seconds." << std::endl;
+/**
+ * @brief      print occupancy and stall counters of the dump pipeline
+ *
+ * @param[in]  pipeline  state of the dump
+ */
+void GameboyCartridge::print_pipeline_statistics(const DumpPipeline& pipeline) const {
+    std::stringstream msg;
+    msg << std::fixed << std::setprecision(1);
+    msg << "Reader -> decoder: " << pipeline.chunks.get_average_occupancy() << " (max "
+        << pipeline.chunks.get_max_occupancy() << ") of " << pipeline.chunks.capacity()
+        << " slots in use, reader stalled " << pipeline.chunks.get_producer_stalls()
+        << " times, decoder stalled " << pipeline.chunks.get_consumer_stalls() << " times" << std::endl;
+    msg << "Decoder -> sink:   " << pipeline.blocks.get_average_occupancy() << " (max "
+        << pipeline.blocks.get_max_occupancy() << ") of " << pipeline.blocks.capacity()
+        << " slots in use, decoder stalled " << pipeline.blocks.get_producer_stalls()
+        << " times, sink stalled " << pipeline.blocks.get_consumer_stalls() << " times" << std::endl;
+    *this->console << msg.str();
 }
 
 /**
- * @brief      Destroys the object.
+ * @brief      read the header of a GBA cartridge
  */
-GameboyCartridge::~GameboyCartridge() {
-    this->port.close();
+void GameboyCartridge::read_gba_header() {
+    *this->console << "Test reading GBA cartridge header info..." << std::flush;
+    std::vector<uint8_t> data(this->GBA_UNIT);
+    this->read_gba(0, data.size(), data.data());
+    this->gba_header.parse(data);
+    this->header.clear();
+    *this->console << "DONE" << std::endl;
+
+    *this->console << "=========================================" << std::endl;
+    this->gba_header.print(*this->console);
+    *this->console << "=========================================" << std::endl;
+
+    if(!this->gba_header.complement_valid()) {
+        *this->console << "Header complement check failed; the cartridge may not be seated correctly" << std::endl;
+    }
 }
 
 /**
- * @brief      writes a command word to ATMEGA
+ * @brief      stream a GBA ROM to disk and request the blocks that failed
+ *             afterwards
  *
- * @param[in]  cmd   command word
+ * @param[in]  output_file  The output file
  *
+ * @return     number of bytes read
  */
-void GameboyCartridge::write_command_word(const char* cmd) {
-    char c[12]; // create buffer
+size_t GameboyCartridge::read_gba_rom(const std::string& output_file) {
+    if(this->resume) {
+        throw std::runtime_error("Resuming a dump is not supported for GBA cartridges");
+    }
 
-    for(unsigned int i=0; i<12; i++) {
-        boost::asio::write(port, boost::asio::buffer(&cmd[i], 1));
-        boost::asio::read(port, boost::asio::buffer(&c,1));
-        if(cmd[i] != c[0]) {
-            std::cerr << "An error occurred during data transfer, aborting!" << std::endl;
-            std::cerr << "Error encountered at " << __FILE__ << " (" << __LINE__ << ")" << std::endl;
-            std::cerr << "Send: " << cmd[i] << " | Receive: " << c[0] << "| i=" << i << std::endl;
-            exit(-1);
+    auto start = std::chrono::system_clock::now();
+
+    const size_t total = this->gba_rom_size();
+    const size_t kbytes = total / this->GBA_UNIT;
+    *this->console << "Reading " << total / 1024 << " KByte GBA ROM... please wait" << std::endl;
+
+    // the ROM is written to disk as it arrives, hence only the rings of the
+    // pipeline are held in memory
+    RomWriter out(output_file, total, false);
+    const size_t trailer = (this->firmware_caps & CAP_CRC) ? 2 : 0;
+    const size_t expected_bytes = (total / this->FRAME_SIZE) * (1 + this->FRAME_SIZE + trailer);
+    // the hashes for the DAT file are taken from the blocks as the sink
+    // stores them, such that the file is only read back after a gap
+    RomHasher hasher;
+    DumpPipeline pipeline(total, expected_bytes, &out, nullptr, nullptr,
+                          this->dat != nullptr ? &hasher : nullptr, total / this->ROM_BANK_SIZE);
+
+    char cmd[13];
+    sprintf(cmd, "GBRD%04X%04X", 0, (unsigned int)kbytes);
+    char expected[17];
+    sprintf(expected, "OFFS%04XKBYT%04X", 0, (unsigned int)kbytes);
+    this->stream_frames(&pipeline, cmd, expected);
+
+    // blocks that failed are listed as (offset, length)
+    std::vector<std::pair<size_t, size_t>> failed = pipeline.failed;
+    if(pipeline.lost_offset < total) {
+        failed.emplace_back(pipeline.lost_offset, total - pipeline.lost_offset);
+    }
+
+    // request the failed blocks once more, in whole kb
+    for(const auto& block : failed) {
+        size_t offset = block.first / this->GBA_UNIT * this->GBA_UNIT;
+        const size_t end = block.first + block.second;
+
+        while(offset < end) {
+            const size_t len = std::min(this->GBA_RETRY_SIZE, (end - offset + this->GBA_UNIT - 1) /
+                                        this->GBA_UNIT * this->GBA_UNIT);
+            std::vector<uint8_t> data(len);
+            this->resent_blocks++;
+            this->resent_bytes += len;
+            this->read_gba(offset, len, data.data());
+            out.write(offset, data.data(), len);
+            if(this->dat != nullptr) {
+                hasher.update(data.data(), offset, len);
+            }
+
+            offset += len;
         }
     }
-}
+    out.sync();
 
-/**
- * @brief      enables or disables RAM banking
- *
- * @param[in]  enable  whether to enable or disable
- */
-void GameboyCartridge::set_ram(bool enable) {
-    if(enable) {
-        std::cout << "Enable RAM BANK" << std::endl;
-    } else {
-        std::cout << "Disable RAM BANK" << std::endl;
+    if(this->verbose) {
+        this->print_pipeline_statistics(pipeline);
     }
 
-    char cmd[13] = {'W', 'R', 'B', 'Y', '0', '0', '0', '0', 'X', 'X', 'X', 'X','0'};
+    // calculate time
+    auto end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
 
-    if(enable) {
-        sprintf(&cmd[4], "%04X%04X", 0x0000, 0x0A);
-    } else {
-        sprintf(&cmd[4], "%04X%04X", 0x0000, 0x00);
+    *this->console << "Done reading " << total << " bytes from ROM in " << elapsed_seconds.count() << " seconds." << std::endl;
+    this->print_transfer_summary();
+
+    this->dat_match.clear();
+    if(this->dat != nullptr) {
+        this->print_dat_match(hasher.finish(out));
     }
 
-    this->write_command_word(cmd);
+    return total;
 }
 
 /**
- * @brief      change ram bank number
+ * @brief      find the size of a GBA ROM; beyond the end of the ROM, either
+ *             the ROM is mirrored or the bus returns the lower 16 bits of the
+ *             halfword address
  *
- * @param[in]  bank_addr  ram bank number
+ * @return     size of the ROM in bytes
  */
-void GameboyCartridge::change_ram_bank(uint8_t bank_addr) {
-    std::cout << "Changing to RAM BANK: " << (int)bank_addr << "  " << std::endl;
+size_t GameboyCartridge::gba_rom_size() {
+    std::vector<uint8_t> first(this->GBA_UNIT);
+    this->read_gba(0, first.size(), first.data());
+
+    std::vector<uint8_t> data(this->GBA_UNIT);
+    for(size_t size = this->GBA_MIN_SIZE; size < this->GBA_MAX_SIZE; size *= 2) {
+        this->read_gba(size, data.size(), data.data());
+        if(data == first) {
+            return size;
+        }
 
-    char cmd[13] = {'W', 'R', 'B', 'Y', '0', '0', '0', '0', 'X', 'X', 'X', 'X','0'};
+        bool open_bus = true;
+        for(size_t i=0; i<data.size() / 2 && open_bus; i++) {
+            const uint16_t value = data[i * 2] | (data[i * 2 + 1] << 8);
+            open_bus = value == ((size / 2 + i) & 0xFFFF);
+        }
+        if(open_bus) {
+            return size;
+        }
+    }
 
-    sprintf(&cmd[4], "%04X%04X", 0x4000, bank_addr);
-    this->write_command_word(cmd);
+    return this->GBA_MAX_SIZE;
 }
 
 /**
- * @brief      change rom bank number
+ * @brief      read a range of a GBA ROM and request it once more until all
+ *             frames match their checksum
  *
- * @param[in]  bank_addr  rom bank number
+ * @param[in]  offset  offset in the ROM (multiple of GBA_UNIT)
+ * @param[in]  len     number of bytes (multiple of GBA_UNIT)
+ * @param      dst     pointer to output buffer
  */
-void GameboyCartridge::change_rom_bank(uint8_t bank_addr) {
-    std::cout << "Changing to ROM BANK: " << (int)bank_addr << "  " << std::endl;
+void GameboyCartridge::read_gba(size_t offset, size_t len, uint8_t* dst) {
+    // blocks that failed are listed as (offset, length)
+    std::vector<std::pair<size_t, size_t>> failed = {{0, len}};
+
+    // request only the failed blocks once more, in whole kb; only rounds
+    // that do not reduce the number of failed bytes count as a failed attempt
+    size_t prev_failed = len + 1;
+    bool first_round = true;
+    for(unsigned int attempt=0; !failed.empty(); attempt++) {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        size_t failed_bytes = 0;
+        for(const auto& block : failed) {
+            const size_t begin = block.first / this->GBA_UNIT * this->GBA_UNIT;
+            const size_t end = (block.first + block.second + this->GBA_UNIT - 1) / this->GBA_UNIT * this->GBA_UNIT;
+            if(!ranges.empty() && ranges.back().first + ranges.back().second >= begin) {
+                ranges.back().second = end - ranges.back().first;
+            } else {
+                ranges.emplace_back(begin, end - begin);
+            }
+            failed_bytes += block.second;
+        }
+        if(failed_bytes < prev_failed) {
+            attempt = 0;
+        }
+        prev_failed = failed_bytes;
 
-    char cmd[13] = {'W', 'R', 'B', 'Y', '0', '0', '0', '0', 'X', 'X', 'X', 'X','0'};
+        if(attempt > this->MAX_RETRIES) {
+            std::stringstream msg;
+            msg << "Could not receive GBA ROM data at 0x" << std::hex << std::setw(7) << std::setfill('0')
+                << (offset + failed.front().first);
+            throw std::runtime_error(msg.str());
+        }
 
-    if(this->cartridge_type >= 5) {
-        sprintf(&cmd[4], "%04X%04X", 0x2100, bank_addr);
-        this->write_command_word(cmd);
-    } else {
-        sprintf(&cmd[4], "%04X%04X", 0x6000, 0x00);
-        this->write_command_word(cmd);
-        sprintf(&cmd[4], "%04X%04X", 0x4000, bank_addr >> 5);
-        this->write_command_word(cmd);
-        sprintf(&cmd[4], "%04X%04X", 0x2100, bank_addr & 0x1F);
-        this->write_command_word(cmd);
+        std::vector<std::pair<size_t, size_t>> again;
+        for(const auto& range : ranges) {
+            if(!first_round) {
+                this->resent_blocks++;
+                this->resent_bytes += range.second;
+            }
+
+            const unsigned int start = (offset + range.first) / this->GBA_UNIT;
+            const unsigned int kbytes = range.second / this->GBA_UNIT;
+            char cmd[13];
+            sprintf(cmd, "GBRD%04X%04X", start, kbytes);
+            char expected[17];
+            sprintf(expected, "OFFS%04XKBYT%04X", start, kbytes);
+
+            std::vector<std::pair<size_t, size_t>> range_failed;
+            this->receive_frames(cmd, expected, range.second, dst + range.first, &range_failed, false, false);
+            for(const auto& b : range_failed) {
+                again.emplace_back(range.first + b.first, b.second);
+            }
+        }
+        failed.swap(again);
+        first_round = false;
     }
 }
 
 /*
- * @brief      read_memory
+ * @brief      read memory using the hex encoded protocol of older firmware
  *
  * @param      _addr          starting address
  * @param      _len           number of bytes to read
@@ -277,32 +1701,45 @@ void GameboyCartridge::change_rom_bank(uint8_t bank_addr) {
  *
  * @return     number of bytes read
  */
-size_t GameboyCartridge::read_memory(uint16_t _addr, uint16_t _len, std::vector<uint8_t> *buffer, bool show_progress) {
+size_t GameboyCartridge::read_memory_hex(uint16_t _addr, uint16_t _len, std::vector<uint8_t> *buffer, bool show_progress) {
     // create buffer
     char c[12];
 
-    char cmd[12] = {'R', 'E', 'A', 'D', '0', '0', '0', '0', '0', '0', '0', '0'};
+    char cmd[13] = {'R', 'E', 'A', 'D', '0', '0', '0', '0', '0', '0', '0', '0', '0'};
     sprintf(&cmd[4], "%04X%04X", _addr, _len);
 
     this->write_command_word(cmd);
 
     // read addr line
-    boost::asio::read(port, boost::asio::buffer(&c,8));
+    this->receive(&c, 8);
     c[8] = '\0';
     size_t addr = strtoul(&c[4], NULL, 16);
 
     // read size line
-    boost::asio::read(port, boost::asio::buffer(&c,8));
+    this->receive(&c, 8);
     c[8] = '\0';
     size_t size = strtoul(&c[4], NULL, 16);
 
+    const size_t base = buffer->size();
+    buffer->resize(base + size);
+    uint8_t* dst = buffer->data() + base;
     size_t bytes = 0;
+
+    // decode all characters that are available in one go
     while(bytes < size) {
-        boost::asio::read(port, boost::asio::buffer(&c,2));
-        c[2] = '\0';
-        uint8_t v = strtoul(c, NULL, 16);
-        buffer->push_back(v);
-        bytes++;
+        if(!this->fill_rx_buffer(2, this->REPLY_TIMEOUT)) {
+            throw std::runtime_error("Timeout while waiting for data");
+        }
+
+        const size_t n = std::min((this->rx_end - this->rx_begin) / 2, size - bytes);
+        const size_t offset = hex_decode(&this->rx_buffer[this->rx_begin], 2 * n, dst + bytes);
+        if(offset != 2 * n) {
+            std::stringstream msg;
+            msg << "Invalid hex character received at offset " << (2 * bytes + offset);
+            throw std::runtime_error(msg.str());
+        }
+        this->rx_begin += 2 * n;
+        bytes += n;
 
         if(show_progress) {
             print_loadbar(bytes, size);
@@ -313,105 +1750,457 @@ size_t GameboyCartridge::read_memory(uint16_t _addr, uint16_t _len, std::vector<
 }
 
 /*
- * @brief      Print information from the ROM header to the screen
+ * @brief      request a range of memory in binary frames and verify every
+ *             frame against its checksum
+ *
+ * @param[in]  _addr          starting address
+ * @param[in]  _len           number of bytes to read
+ * @param      dst            pointer to output buffer
+ * @param      failed         blocks (offset, length) that were not received
+ * @param[in]  show_progress  whether to show a progress bar
  */
-void GameboyCartridge::print_header_details() {
+void GameboyCartridge::read_frames(uint16_t _addr, uint16_t _len, uint8_t* dst,
+                                   std::vector<std::pair<size_t, size_t>>* failed, bool show_progress) {
+    char cmd[13];
+    sprintf(cmd, "%s%04X%04X", this->compressed_read ? "RDRL" : "RDBN", _addr, _len);
+
+    // every transfer starts with the address and size lines
+    char expected[17];
+    sprintf(expected, "ADDR%04XSIZE%04X", _addr, _len);
+
+    this->receive_frames(cmd, expected, _len, dst, failed, show_progress, this->compressed_read);
+}
+
+/*
+ * @brief      send a command that is answered by a header and binary frames
+ *             and verify every frame against its checksum
+ *
+ * @param[in]  cmd            command word
+ * @param[in]  expected       header the firmware replies with (16 chars)
+ * @param[in]  _len           number of bytes to read
+ * @param      dst            pointer to output buffer
+ * @param      failed         blocks (offset, length) that were not received
+ * @param[in]  show_progress  whether to show a progress bar
+ * @param[in]  compressed     whether the frames are run-length encoded
+ */
+void GameboyCartridge::receive_frames(const char* cmd, const char* expected, size_t _len, uint8_t* dst,
+                                      std::vector<std::pair<size_t, size_t>>* failed, bool show_progress,
+                                      bool compressed) {
+    this->write_command_word(cmd);
+
+    char c[17];
+    if(!this->read_timeout(c, 16, this->REPLY_TIMEOUT) || strncmp(c, expected, 16) != 0) {
+        failed->emplace_back(0, _len);
+        this->resync();
+        return;
+    }
+
+    size_t bytes = 0;
+    size_t received = 0;
+
+    while(bytes < _len) {
+        const size_t expected_len = std::min(this->FRAME_SIZE, _len - bytes);
+        const int result = this->read_frame(dst + bytes, expected_len, compressed, &received);
+
+        // without a valid length byte, the stream can no longer be followed
+        if(result == FRAME_LOST) {
+            failed->emplace_back(bytes, _len - bytes);
+            this->resync();
+            return;
+        }
+
+        if(result == FRAME_CORRUPT) {
+            failed->emplace_back(bytes, expected_len);
+        }
+
+        bytes += expected_len;
+
+        if(show_progress) {
+            print_loadbar(bytes, _len);
+        }
+    }
+
+    this->encoded_bytes += received;
+
+    // the firmware reports the number of bytes it has sent
+    if(compressed) {
+        if(!this->read_timeout(c, 8, this->REPLY_TIMEOUT) || strncmp(c, "CMPR", 4) != 0 ||
+           strtoul(std::string(&c[4], 4).c_str(), NULL, 16) != received) {
+            // without checksums, none of the data can be trusted
+            if(!(this->firmware_caps & CAP_CRC)) {
+                failed->clear();
+                failed->emplace_back(0, _len);
+            }
+            this->resync();
+        }
+    }
+}
+
+/**
+ * @brief      receive a single binary frame and verify it against its
+ *             checksum
+ *
+ * @param      dst           pointer to output buffer
+ * @param[in]  expected_len  number of (decoded) payload bytes
+ * @param[in]  compressed    whether the payload is run-length encoded
+ * @param      received      incremented by the number of bytes received
+ *
+ * @return     FRAME_VALID, FRAME_CORRUPT or FRAME_LOST
+ */
+int GameboyCartridge::read_frame(uint8_t* dst, size_t expected_len, bool compressed, size_t* received) {
+    // every frame consists of a length byte followed by the payload and,
+    // when supported, the CRC-16 of the (decoded) payload; a compressed
+    // frame may hold one byte more than FRAME_SIZE
+    const size_t max_flen = compressed ? this->FRAME_SIZE + 1 : this->FRAME_SIZE;
+    const size_t trailer = (this->firmware_caps & CAP_CRC) ? 2 : 0;
+
+    // decode straight from the receive buffer
+    if(!this->fill_rx_buffer(1, this->REPLY_TIMEOUT)) {
+        return FRAME_LOST;
+    }
+
+    const size_t flen = this->rx_buffer[this->rx_begin];
+    if(flen == 0 || flen > max_flen || (!compressed && flen != expected_len) ||
+       !this->fill_rx_buffer(flen + 1 + trailer, this->REPLY_TIMEOUT)) {
+        return FRAME_LOST;
+    }
+
+    const uint8_t* frame = &this->rx_buffer[this->rx_begin];
+    this->rx_begin += flen + 1 + trailer;
+    *received += flen + 1 + trailer;
+
+    bool valid = true;
+    if(compressed) {
+        valid = this->decode_pack_bits(&frame[1], flen, dst, expected_len) == (long)expected_len;
+    } else {
+        memcpy(dst, &frame[1], flen);
+    }
+
+    if(trailer > 0) {
+        const uint16_t crc = (frame[flen + 1] << 8) | frame[flen + 2];
+        valid = valid && crc16(dst, expected_len) == crc;
+    }
+
+    return valid ? FRAME_VALID : FRAME_CORRUPT;
+}
+
+/**
+ * @brief      decode PackBits run-length encoded data
+ *
+ * @param[in]  src      encoded data
+ * @param[in]  len      number of encoded bytes
+ * @param      dst      output buffer
+ * @param[in]  dst_len  size of the output buffer
+ *
+ * @return     number of decoded bytes or -1 for malformed input
+ */
+long GameboyCartridge::decode_pack_bits(const uint8_t* src, size_t len, uint8_t* dst, size_t dst_len) const {
+    size_t i = 0;
+    size_t o = 0;
+
+    while(i < len) {
+        const uint8_t hdr = src[i++];
+
+        if(hdr < 128) {         // literal bytes
+            const size_t n = hdr + 1;
+            if(i + n > len || o + n > dst_len) {
+                return -1;
+            }
+            memcpy(&dst[o], &src[i], n);
+            i += n;
+            o += n;
+        } else if(hdr > 128) {  // repeated byte
+            const size_t n = 257 - hdr;
+            if(i >= len || o + n > dst_len) {
+                return -1;
+            }
+            memset(&dst[o], src[i++], n);
+            o += n;
+        }
+    }
+
+    return o;
+}
+
+/**
+ * @brief      print the compression ratio of the last read_memory call
+ *
+ * @param[in]  bytes  number of decoded bytes
+ */
+void GameboyCartridge::print_compression_ratio(size_t bytes) const {
+    if(!this->compressed_read || this->legacy_protocol || this->encoded_bytes == 0) {
+        return;
+    }
+
+    std::stringstream ratio;
+    ratio << std::fixed << std::setprecision(2) << (double)bytes / (double)this->encoded_bytes;
+
+    *this->console << "Compression ratio: " << ratio.str() << " (" << bytes << " -> "
+                   << this->encoded_bytes << " bytes)" << std::endl;
+}
+
+/**
+ * @brief      write memory in verified blocks, keeping WRITE_WINDOW
+ *             blocks in flight
+ *
+ * @param[in]  _addr          starting address
+ * @param[in]  data           pointer to data
+ * @param[in]  _len           number of bytes to write
+ * @param[in]  show_progress  whether to show a progress bar
+ *
+ * @return     number of bytes written
+ */
+size_t GameboyCartridge::write_memory(uint16_t _addr, const uint8_t* data, uint16_t _len, bool show_progress) {
+    const size_t nrblocks = (_len + this->BLOCK_SIZE - 1) / this->BLOCK_SIZE;
+    std::vector<size_t> blocks(nrblocks);
+    std::iota(blocks.begin(), blocks.end(), 0);
+
+    // write only the failed blocks once more; only rounds that do not
+    // reduce the number of failed blocks count as a failed attempt
+    size_t prev_failed = blocks.size() + 1;
+    bool first_round = true;
+    for(unsigned int attempt=0; !blocks.empty(); attempt++) {
+        if(blocks.size() < prev_failed) {
+            attempt = 0;
+        }
+        prev_failed = blocks.size();
+
+        if(attempt > this->MAX_RETRIES) {
+            std::stringstream msg;
+            msg << "Could not write data at 0x" << std::hex << std::setw(4) << std::setfill('0')
+                << (_addr + blocks.front() * this->BLOCK_SIZE);
+            throw std::runtime_error(msg.str());
+        }
+
+        if(!first_round) {
+            for(size_t block : blocks) {
+                this->resent_blocks++;
+                this->resent_bytes += std::min(this->BLOCK_SIZE, _len - block * this->BLOCK_SIZE);
+            }
+        }
+
+        std::vector<size_t> failed;
+        this->write_blocks(_addr, data, _len, blocks, &failed, show_progress && first_round);
+        blocks.swap(failed);
+        first_round = false;
+    }
+
+    return _len;
+}
+
+/**
+ * @brief      write a selection of blocks, keeping WRITE_WINDOW blocks in
+ *             flight
+ *
+ * @param[in]  _addr          starting address
+ * @param[in]  data           pointer to data
+ * @param[in]  _len           number of bytes
+ * @param[in]  blocks         indices of the blocks to write
+ * @param      failed         indices of the blocks that failed
+ * @param[in]  show_progress  whether to show a progress bar
+ */
+void GameboyCartridge::write_blocks(uint16_t _addr, const uint8_t* data, uint16_t _len,
+                                    const std::vector<size_t>& blocks, std::vector<size_t>* failed,
+                                    bool show_progress) {
+    size_t sent = 0;
+    size_t acked = 0;
+    size_t bytes = 0;
+
+    while(acked < blocks.size()) {
+        // send blocks until the window is full
+        while(sent < blocks.size() && sent - acked < this->WRITE_WINDOW) {
+            const size_t offset = blocks[sent] * this->BLOCK_SIZE;
+            const size_t len = std::min(this->BLOCK_SIZE, _len - offset);
+
+            char cmd[13];
+            sprintf(cmd, "WRBK%04X%04X", (unsigned int)(_addr + offset), (unsigned int)len);
+
+            std::vector<uint8_t> frame;
+            this->append_command_frame(&frame, cmd);
+            frame.insert(frame.end(), data + offset, data + offset + len);
+            boost::asio::write(port, boost::asio::buffer(frame));
+            sent++;
+        }
+
+        // collect command acknowledgement and checksum of the oldest block
+        const size_t offset = blocks[acked] * this->BLOCK_SIZE;
+        const size_t len = std::min(this->BLOCK_SIZE, _len - offset);
+
+        char cmd[13];
+        sprintf(cmd, "WRBK%04X%04X", (unsigned int)(_addr + offset), (unsigned int)len);
+
+        uint8_t ack[5];
+        const uint8_t cmd_crc = crc8((const uint8_t*)cmd, 12);
+        const uint16_t block_crc = crc16(data + offset, len);
+
+        // without an acknowledgement, all blocks in flight are retried later;
+        // the firmware replies with CMD_REJECT instead of 'K' when (part of)
+        // the block did not arrive
+        if(!this->read_timeout(ack, 2, this->REPLY_TIMEOUT) || ack[0] != (uint8_t)this->CMD_FRAME ||
+           ack[1] != cmd_crc || !this->read_timeout(&ack[2], 1, this->WRITE_TIMEOUT) || ack[2] != 'K' ||
+           !this->read_timeout(&ack[3], 2, this->REPLY_TIMEOUT)) {
+            for(; acked < sent; acked++) {
+                failed->push_back(blocks[acked]);
+                bytes += std::min(this->BLOCK_SIZE, _len - blocks[acked] * this->BLOCK_SIZE);
+            }
+            this->resync();
+            continue;
+        }
+
+        if(ack[3] != (block_crc >> 8) || ack[4] != (block_crc & 0xFF)) {
+            failed->push_back(blocks[acked]);
+        }
+
+        acked++;
+        bytes += len;
+
+        if(show_progress) {
+            print_loadbar(bytes, _len);
+        }
+    }
+}
+
+/**
+ * @brief      print the number of retransmissions and, in verbose mode,
+ *             the number of reads on the serial port
+ */
+void GameboyCartridge::print_transfer_summary() const {
+    if(!this->legacy_protocol) {
+        *this->console << "Retransmitted " << this->resent_blocks << " blocks (" << this->resent_bytes
+                       << " bytes) and " << this->resent_commands << " commands." << std::endl;
+    }
+
+    if(this->verbose && this->rx_bytes > 0) {
+        std::stringstream msg;
+        msg << "Received " << this->rx_bytes << " bytes in " << this->rx_reads << " reads ("
+            << std::fixed << std::setprecision(2) << (this->rx_reads * 1024.0 / this->rx_bytes)
+            << " reads per KB)";
+        *this->console << msg.str() << std::endl;
+    }
+}
+
+/**
+ * @brief      title of the cartridge as stored in the header
+ *
+ * @return     title without trailing padding
+ */
+std::string GameboyCartridge::get_title() const {
+    if(this->gba_mode) {
+        return this->gba_header.get_title();
+    }
+
     std::string title;
 
     for(unsigned int i=0x0134; i<0x0143; i++) {
+        if(this->header[i] == 0x00) {
+            break;
+        }
         title += (char)this->header[i];
     }
 
-    std::cout << "Cartridge title: " << title << std::endl;
+    return title.substr(0, title.find_last_not_of(' ') + 1);
+}
+
+/*
+ * @brief      Print information from the ROM header to the screen
+ */
+void GameboyCartridge::print_header_details() {
+    *this->console << "Cartridge title: " << this->get_title() << std::endl;
 
-    std::cout << "Cartridge type:  ";
+    *this->console << "Cartridge type:  ";
     switch(this->header[0x0147]) {
         case 0x00:
-            std::cout << "ROM ONLY";
+            *this->console << "ROM ONLY";
         break;
         case 0x01:
-            std::cout << "MBC1";
+            *this->console << "MBC1";
         break;
         case 0x02:
-            std::cout << "MBC1+RAM";
+            *this->console << "MBC1+RAM";
         break;
         case 0x03:
-            std::cout << "MBC1+RAM+BATTERY";
+            *this->console << "MBC1+RAM+BATTERY";
         break;
         case 0x05:
-            std::cout << "MBC2";
+            *this->console << "MBC2";
         break;
         case 0x06:
-            std::cout << "MBC2+BATTERY";
+            *this->console << "MBC2+BATTERY";
         break;
         case 0x08:
-            std::cout << "ROM+RAM";
+            *this->console << "ROM+RAM";
         break;
         case 0x09:
-            std::cout << "ROM+RAM+BATTERY";
+            *this->console << "ROM+RAM+BATTERY";
         break;
         case 0x0F:
-            std::cout << "MBC3+TIMER+BATTERY";
+            *this->console << "MBC3+TIMER+BATTERY";
         break;
         case 0x10:
-            std::cout << "MBC3+TIMER+RAM+BATTERY";
+            *this->console << "MBC3+TIMER+RAM+BATTERY";
         break;
         case 0x11:
-            std::cout << "MBC3";
+            *this->console << "MBC3";
         break;
         case 0x12:
-            std::cout << "MBC3+RAM";
+            *this->console << "MBC3+RAM";
         break;
         case 0x13:
-            std::cout << "MBC3+RAM+BATTERY";
+            *this->console << "MBC3+RAM+BATTERY";
         break;
         case 0x19:
-            std::cout << "MBC5";
+            *this->console << "MBC5";
         break;
         case 0x1A:
-            std::cout << "MBC5+RAM";
+            *this->console << "MBC5+RAM";
         break;
         case 0x1B:
-            std::cout << "MBC5+RAM+BATTERY";
+            *this->console << "MBC5+RAM+BATTERY";
         break;
         default:
-            std::cout << "Unknown type: " << (int)header[0x147];
+            *this->console << "Unknown type: " << (int)header[0x147];
         break;
     }
-    std::cout << " (" << (int)this->header[0x0147] << ")";
-    std::cout << std::endl;
+    *this->console << " (" << (int)this->header[0x0147] << ")";
+    *this->console << std::endl;
 
-    std::cout << "ROM Size:        ";
+    *this->console << "ROM Size:        ";
     switch(this->header[0x0148]) {
         case 0x00:
-            std::cout << "32KByte (no ROM banking)";
+            *this->console << "32KByte (no ROM banking)";
         break;
         case 0x01:
-            std::cout << "64KByte (4 banks)";
+            *this->console << "64KByte (4 banks)";
         break;
         case 0x02:
-            std::cout << "128 KByte (8 banks)";
+            *this->console << "128 KByte (8 banks)";
         break;
         case 0x03:
-            std::cout << "256KByte (16 banks)";
+            *this->console << "256KByte (16 banks)";
         break;
         case 0x04:
-            std::cout << "512KByte (32 banks)";
+            *this->console << "512KByte (32 banks)";
         break;
         case 0x05:
-            std::cout << "1MByte (64 banks)";
+            *this->console << "1MByte (64 banks)";
         break;
         case 0x06:
-            std::cout << "2MByte (128 banks)";
+            *this->console << "2MByte (128 banks)";
         break;
         case 0x07:
-            std::cout << "4MByte (256 banks)";
+            *this->console << "4MByte (256 banks)";
+        break;
+        case 0x08:
+            *this->console << "8MByte (512 banks)";
         break;
         default:
-            std::cout << "Unknown size: " << (int)this->header[0x148];
+            *this->console << "Unknown size: " << (int)this->header[0x148];
         break;
     }
-    std::cout << std::endl;
+    *this->console << std::endl;
+
+    *this->console << "RAM Size:        "
+                   << RamLayout(this->header[0x147], this->header[0x149]).describe() << std::endl;
 }
 
 /*
@@ -450,6 +2239,9 @@ int GameboyCartridge::get_number_rom_banks() {
         case 0x07:
             return 256;
         break;
+        case 0x08:
+            return 512;
+        break;
     }
 
     return 0;
@@ -470,10 +2262,34 @@ void GameboyCartridge::print_loadbar(unsigned int x, unsigned int n, unsigned in
     float ratio  =  x/(float)n;
     int   c      =  ratio * w;
 
-    std::cout << std::setw(3) << (int)(ratio*100) << "% [";
-    for (int x=0; x<c; x++) std::cout << "=";
-    for (int x=c; x<w; x++) std::cout << " ";
-    std::cout << "]\r" << std::flush;
+    *this->console << std::setw(3) << (int)(ratio*100) << "% [";
+    for (int x=0; x<c; x++) *this->console << "=";
+    for (int x=c; x<w; x++) *this->console << " ";
+    *this->console << "]\r" << std::flush;
+}
+
+/**
+ * @brief      progress bar with the transfer rate and the estimated time
+ *             until the transfer is complete
+ *
+ * @param[in]  x        bytes transferred
+ * @param[in]  n        total number of bytes
+ * @param[in]  seconds  time since the transfer started
+ * @param[in]  w        width of the progress bar
+ */
+void GameboyCartridge::print_progress(size_t x, size_t n, double seconds, unsigned int w) {
+    const float ratio = x / (float)n;
+    const unsigned int c = ratio * w;
+
+    std::stringstream msg;
+    msg << std::setw(3) << (int)(ratio * 100) << "% [" << std::string(c, '=') << std::string(w - c, ' ') << "]";
+    if(x > 0 && seconds > 0) {
+        const double rate = x / seconds;
+        const unsigned int eta = (n - x) / rate;
+        msg << " " << std::fixed << std::setprecision(1) << rate / 1024 << " KB/s, ETA "
+            << eta / 60 << ":" << std::setw(2) << std::setfill('0') << eta % 60;
+    }
+    *this->console << msg.str() << "   \r" << std::flush;
 }
 
 /**
@@ -496,11 +2312,9 @@ void GameboyCartridge::write_byte(uint16_t addr, uint8_t val) {
  * @param[in]  outfile  The outfile
  */
 void GameboyCartridge::write_to_file(const std::vector<uint8_t>& data, const std::string& outfile) {
-    // store ROM data into file
-    std::ofstream out(outfile.c_str());
-    for(auto v: data) {
-        out << v;
-    }
+    // store data into file
+    std::ofstream out(outfile.c_str(), std::ios::binary);
+    out.write((const char*)data.data(), data.size());
     out.close();
 }
 
@@ -30,20 +30,120 @@
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <cstring>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <map>
+#include <random>
+
+#include "crc.h"
+#include "hex_decode.h"
+#include "dump_pipeline.h"
+#include "rom_writer.h"
+#include "dump_journal.h"
+#include "rom_verifier.h"
+#include "dat_index.h"
+#include "ram_layout.h"
+#include "gba_header.h"
 
 class GameboyCartridge {
 private:
     std::vector<uint8_t> header;
-    std::vector<uint8_t> rom_data;
     std::vector<uint8_t> ram_data;
 
     uint8_t cartridge_type;
-    uint8_t nrbanks;
+    uint16_t nrbanks;
 
     boost::asio::io_service io;
     boost::asio::serial_port port;
 
-    const size_t BAUD_RATE = 57600;
+    const size_t BAUD_RATE = 57600;    // baud rate upon opening the port
+    size_t max_baud_rate = 2000000;    // highest baud rate to negotiate
+    size_t baud_rate;                  // current baud rate
+
+    // baud rates supported by the firmware, in order of the HELO bitmask
+    const std::vector<size_t> BAUD_RATES = {57600, 115200, 500000, 1000000, 2000000};
+    const unsigned int BAUD_TEST_TIMEOUT = 250;     // ms
+    const std::vector<uint8_t> BAUD_TEST_PATTERN = {0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC,
+                                                    0x01, 0x80, 0x7E, 0x81, 0xA5, 0x5A, 0x3C, 0xC3};
+
+    // firmware capabilities as reported upon HELO
+    enum {
+        CAP_BINARY_READ     = (1 << 0),
+        CAP_FRAMED_COMMAND  = (1 << 1),
+        CAP_BLOCK_WRITE     = (1 << 2),
+        CAP_BAUD_SWITCH     = (1 << 3),
+        CAP_RLE_READ        = (1 << 4),
+        CAP_CRC             = (1 << 5),
+        CAP_BENCHMARK       = (1 << 6),
+        CAP_DUMP            = (1 << 7),
+        CAP_BLOCK_CRC       = (1 << 8),
+        CAP_GBA             = (1 << 9),
+    };
+
+    // outcome of receiving a single binary frame
+    enum {
+        FRAME_VALID,        // payload matches its checksum
+        FRAME_CORRUPT,      // payload was received, but is damaged
+        FRAME_LOST,         // stream can no longer be followed
+    };
+
+    unsigned int firmware_version = 0;
+    unsigned int firmware_caps = 0;
+    unsigned int firmware_baud_rates = 0;
+    const size_t FRAME_SIZE = 128;     // maximum payload of a binary frame
+    const char CMD_FRAME = ':';        // start byte of a framed command
+    const char CMD_ABORT = '\0';       // stops a stream; ignored by an idle firmware
+    const size_t ROM_BANK_SIZE = 0x4000;
+    const size_t BLOCK_SIZE = 256;     // size of a verified write block
+    const size_t WRITE_WINDOW = 2;     // number of write blocks in flight
+    const size_t CRC_BLOCK_SIZE = 0x100; // bytes covered by a checksum of BCRC
+
+    const unsigned int MAX_RETRIES = 5;        // attempts per failed block
+    const unsigned int REPLY_TIMEOUT = 1000;   // ms
+    const unsigned int WRITE_TIMEOUT = 2000;   // ms
+    const unsigned int RESYNC_IDLE = 50;       // ms of silence to resynchronize
+    const unsigned int PIPELINE_WAIT = 100;    // us to wait for a pipeline slot
+    const unsigned int BENCHMARK_READS = 0x1000; // reads to average cycle counts over
+    const unsigned int VERIFY_BANKS = 16;      // banks to sample when verifying a dump
+    const size_t VERIFY_SAMPLE = 0x100;        // bytes to compare per sampled bank
+    const size_t GBA_UNIT = 0x400;             // GBA ranges are requested in kb
+    const size_t GBA_MIN_SIZE = 0x40000;       // smallest GBA ROM size that is probed
+    const size_t GBA_MAX_SIZE = 0x2000000;     // largest GBA ROM (32 MB)
+    const size_t GBA_RETRY_SIZE = 0x10000;     // bytes per request when retrying
+
+    // transfer statistics
+    size_t resent_commands = 0;
+    size_t resent_blocks = 0;
+    size_t resent_bytes = 0;
+    size_t rx_reads = 0;               // read calls on the serial port
+    size_t rx_bytes = 0;               // bytes returned by these calls
+
+    // receive buffer; every read pulls in whatever the driver has available
+    // and the bytes in [rx_begin, rx_end) are yet to be consumed
+    const size_t RX_BUFFER_SIZE = 0x10000;
+    std::vector<uint8_t> rx_buffer;
+    size_t rx_begin = 0;
+    size_t rx_end = 0;
+
+    bool legacy_protocol = false;      // use hex encoded transfers
+    bool compressed_read = false;      // use run-length encoded transfers
+    size_t encoded_bytes = 0;          // bytes received by last read_memory
+    bool verbose = false;              // print link statistics
+    bool resume = false;               // continue an interrupted dump
+    std::ostream* console = &std::cout; // destination of progress messages
+    const DatIndex* dat = nullptr;     // catalogue to look dumps up in
+    std::string dat_match;             // name of the game of the last dump
+    bool gba_mode = false;             // cartridge is a GBA cartridge
+    GbaHeader gba_header;              // header of a GBA cartridge
 
     std::string port_url;
 
@@ -62,25 +162,187 @@ public:
     void init();
 
     /**
-     * @brief      load sram into cartridge from file
+     * @brief      read the header of the inserted cartridge; cartridges may
+     *             be swapped while the port stays open
+     */
+    void read_header();
+
+    /**
+     * @brief      select the (slower) hex encoded protocol of older firmware
+     *
+     * @param[in]  legacy  whether to use the legacy protocol
+     */
+    inline void set_legacy_protocol(bool legacy) {
+        this->legacy_protocol = legacy;
+    }
+
+    /**
+     * @brief      request run-length encoded transfers from the firmware
+     *
+     * @param[in]  compressed  whether to use compression
+     */
+    inline void set_compressed_read(bool compressed) {
+        this->compressed_read = compressed;
+    }
+
+    /**
+     * @brief      set the highest baud rate to negotiate
+     *
+     * @param[in]  baud  baud rate
+     */
+    inline void set_max_baud_rate(size_t baud) {
+        this->max_baud_rate = baud;
+    }
+
+    /**
+     * @brief      print statistics on the serial link
+     *
+     * @param[in]  _verbose  whether to print statistics
+     */
+    inline void set_verbose(bool _verbose) {
+        this->verbose = _verbose;
+    }
+
+    /**
+     * @brief      continue an interrupted dump using its journal
+     *
+     * @param[in]  _resume  whether to resume
+     */
+    inline void set_resume(bool _resume) {
+        this->resume = _resume;
+    }
+
+    /**
+     * @brief      send progress messages to another stream than std::cout
+     *
+     * @param      _console  output stream
+     */
+    inline void set_console(std::ostream* _console) {
+        this->console = _console;
+    }
+
+    /**
+     * @brief      look up every dump in a DAT file
+     *
+     * @param[in]  _dat  index of the DAT file
+     */
+    inline void set_dat_index(const DatIndex* _dat) {
+        this->dat = _dat;
+    }
+
+    /**
+     * @brief      start counting retransmissions and reads anew, such that
+     *             the statistics of a job on a board that stays connected
+     *             do not include those of earlier jobs
+     */
+    inline void reset_statistics() {
+        this->resent_commands = 0;
+        this->resent_blocks = 0;
+        this->resent_bytes = 0;
+        this->rx_reads = 0;
+        this->rx_bytes = 0;
+    }
+
+    /**
+     * @brief      read GBA rather than GB cartridges; requires firmware
+     *             built for a board with the GBA wiring
+     *
+     * @param[in]  gba   whether to read GBA cartridges
+     */
+    inline void set_gba_mode(bool gba) {
+        this->gba_mode = gba;
+    }
+
+    /**
+     * @brief      whether GBA cartridges are read
+     */
+    inline bool is_gba_mode() const {
+        return this->gba_mode;
+    }
+
+    /**
+     * @brief      name of the game in the DAT file that matches the last
+     *             dump, empty when there is no match
+     */
+    inline const std::string& get_dat_match() const {
+        return this->dat_match;
+    }
+
+    /**
+     * @brief      print the hashes of a dump and the game it matches in the
+     *             DAT file
+     *
+     * @param[in]  hashes  hashes of the dump
+     */
+    void print_dat_match(const RomHashes& hashes);
+
+    /**
+     * @brief      title of the cartridge as stored in the header
+     *
+     * @return     title without trailing padding
+     */
+    std::string get_title() const;
+
+    /**
+     * @brief      header checksum (0x14D)
+     */
+    inline uint8_t get_header_checksum() const {
+        return this->header[0x14D];
+    }
+
+    /**
+     * @brief      global checksum (0x14E-0x14F)
+     */
+    inline uint16_t get_global_checksum() const {
+        return (this->header[0x14E] << 8) | this->header[0x14F];
+    }
+
+    /**
+     * @brief      compare randomly chosen blocks of the cartridge with an
+     *             earlier dump
+     *
+     * @param[in]  path  path to the dump
+     *
+     * @return     whether the size and all blocks match
+     */
+    bool verify_rom(const std::string& path);
+
+    /**
+     * @brief      measure the number of clock cycles the firmware spends on
+     *             reading a single byte from the cartridge
+     */
+    void benchmark();
+
+    /**
+     * @brief      load sram into cartridge from file; when the firmware
+     *             reports block checksums, only the blocks that differ from
+     *             the file are written
      *
      * @param[in]  input_file  Input file
+     *
+     * @return     number of bytes transferred
      */
-    void load_ram(const std::string& input_file);
+    size_t load_ram(const std::string& input_file);
 
     /**
-     * @brief      read sram from cartridge
+     * @brief      read sram from cartridge; when the output file holds an
+     *             earlier backup and the firmware reports block checksums,
+     *             only the blocks that differ from that backup are read
      *
      * @param[in]  output_file  The output file
+     *
+     * @return     number of bytes transferred
      */
-    void read_ram(const std::string& output_file);
+    size_t read_ram(const std::string& output_file);
 
     /**
      * @brief      read rom from cartridge
      *
      * @param[in]  output_file  The output file
+     *
+     * @return     number of bytes transferred
      */
-    void read_rom(const std::string& output_file);
+    size_t read_rom(const std::string& output_file);
 
     /**
      * @brief      Destroys the object.
@@ -98,11 +360,100 @@ private:
     void write_command_word(const char* cmd);
 
     /**
-     * @brief      enables or disables RAM banking
+     * @brief      writes a series of command words to ATMEGA in a single
+     *             transfer and collect their acknowledgements afterwards
+     *
+     * @param[in]  cmds  command words
+     */
+    void write_command_words(const std::vector<std::string>& cmds);
+
+    /**
+     * @brief      append a framed command to a transfer buffer
+     *
+     * @param      frames  transfer buffer
+     * @param[in]  cmd     command word
+     */
+    void append_command_frame(std::vector<uint8_t>* frames, const char* cmd) const;
+
+    /**
+     * @brief      wait until the link is idle and discard all received data
+     */
+    void resync();
+
+    /**
+     * @brief      read from the serial port, giving up after a timeout
+     *
+     * @param      data        pointer to buffer
+     * @param[in]  len         number of bytes to read
+     * @param[in]  timeout_ms  timeout in milliseconds
+     *
+     * @return     whether all bytes were received in time
+     */
+    bool read_timeout(void* data, size_t len, unsigned int timeout_ms);
+
+    /**
+     * @brief      read from the serial port and throw when no data arrives
+     *             within REPLY_TIMEOUT
+     *
+     * @param      data  pointer to buffer
+     * @param[in]  len   number of bytes to read
+     */
+    void receive(void* data, size_t len);
+
+    /**
+     * @brief      make sure the receive buffer holds at least len bytes,
+     *             giving up after a timeout
+     *
+     * @param[in]  len         number of bytes
+     * @param[in]  timeout_ms  timeout in milliseconds
+     *
+     * @return     whether the bytes were received in time
+     */
+    bool fill_rx_buffer(size_t len, unsigned int timeout_ms);
+
+    /**
+     * @brief      discard any data that is waiting in the receive queue
+     */
+    void flush_input();
+
+    /**
+     * @brief      query firmware version, capabilities and baud rates
+     *
+     * @param[in]  framed  whether to send HELO as a framed command
+     *
+     * @return     whether the firmware replied
+     */
+    bool query_hello(bool framed);
+
+    /**
+     * @brief      switch both ends to the fastest baud rate that passes the
+     *             link test
+     */
+    void negotiate_baud_rate();
+
+    /**
+     * @brief      switch both ends to another baud rate and test the link
+     *
+     * @param[in]  idx   index of the baud rate in BAUD_RATES
+     *
+     * @return     whether the link works at the new baud rate
+     */
+    bool switch_baud_rate(unsigned int idx);
+
+    /**
+     * @brief      set the baud rate of the host end of the link
+     *
+     * @param[in]  baud  baud rate
+     */
+    void set_port_baud_rate(size_t baud);
+
+    /**
+     * @brief      enables or disables access to the RAM
      *
+     * @param[in]  layout  layout of the RAM
      * @param[in]  enable  whether to enable or disable
      */
-    void set_ram(bool enable);
+    void set_ram(const RamLayout& layout, bool enable);
 
     /**
      * @brief      change ram bank number
@@ -115,8 +466,10 @@ private:
      * @brief      change rom bank number
      *
      * @param[in]  bank_addr  rom bank number
+     *
+     * @return     address at which the bank is visible
      */
-    void change_rom_bank(uint8_t bank_addr);
+    uint16_t change_rom_bank(uint16_t bank_addr);
 
     /*
      * read_memory
@@ -129,6 +482,267 @@ private:
      */
     size_t read_memory(uint16_t _addr, uint16_t _len, std::vector<uint8_t> *buffer, bool show_progress = false);
 
+    /*
+     * @brief      read a range of memory in binary frames and request the
+     *             blocks that failed once more
+     *
+     * @param[in]  _addr          starting address
+     * @param[in]  _len           number of bytes to read
+     * @param      dst            pointer to output buffer
+     * @param[in]  show_progress  whether to show a progress bar
+     */
+    void read_verified(uint16_t _addr, uint16_t _len, uint8_t* dst, bool show_progress);
+
+    /**
+     * @brief      whether the firmware can report checksums of memory
+     *             blocks, such that only blocks that changed are transferred
+     *
+     * @return     whether incremental transfers are available
+     */
+    bool has_block_crc() const;
+
+    /**
+     * @brief      let the firmware compute the CRC-16 of every block of
+     *             CRC_BLOCK_SIZE bytes in a range of memory
+     *
+     * @param[in]  _addr  starting address
+     * @param[in]  _len   number of bytes
+     *
+     * @return     checksum of every block
+     */
+    std::vector<uint16_t> read_block_crcs(uint16_t _addr, uint16_t _len);
+
+    /**
+     * @brief      compare a range of memory with a copy on the host and
+     *             collect the blocks that differ
+     *
+     * @param[in]  _addr  starting address
+     * @param[in]  _len   number of bytes
+     * @param[in]  data   copy of the memory on the host
+     *
+     * @return     adjacent blocks that differ, merged as (offset, length)
+     */
+    std::vector<std::pair<size_t, size_t>> changed_blocks(uint16_t _addr, uint16_t _len, const uint8_t* data);
+
+    /**
+     * @brief      let the firmware stream all ROM banks in a single transfer
+     *             and request the blocks that failed afterwards; the stream
+     *             is received, decoded and stored by three separate threads
+     *
+     * @param      out       output file
+     * @param      journal   journal of the dump
+     * @param      verifier  checksums of the dump
+     *
+     * @return     number of bytes read
+     */
+    size_t dump_rom(RomWriter* out, DumpJournal* journal, RomVerifier* verifier);
+
+    /**
+     * @brief      read a single ROM bank, store it and record it in the
+     *             journal
+     *
+     * @param[in]  bank      bank number
+     * @param      out       output file
+     * @param      journal   journal of the dump
+     * @param      verifier  checksums of the dump
+     *
+     * @return     number of bytes read
+     */
+    size_t read_bank(size_t bank, RomWriter* out, DumpJournal* journal, RomVerifier* verifier);
+
+    /**
+     * @brief      account for stored blocks and record every bank that is
+     *             complete in the journal
+     *
+     * @param      pipeline  state of the dump
+     * @param[in]  offset    offset of the blocks in the ROM
+     * @param[in]  len       number of bytes
+     */
+    void complete_blocks(DumpPipeline* pipeline, size_t offset, size_t len);
+
+    /**
+     * @brief      serial reader stage of a ROM dump: pass everything the
+     *             driver has received on to the decoder
+     *
+     * @param      pipeline  state of the dump
+     */
+    void dump_reader(DumpPipeline* pipeline);
+
+    /**
+     * @brief      decoder stage of a ROM dump: split the received data into
+     *             frames, verify them and place their payload in the ROM
+     *             buffer
+     *
+     * @param      pipeline  state of the dump
+     */
+    void dump_decoder(DumpPipeline* pipeline);
+
+    /**
+     * @brief      sink stage of a ROM dump: write the verified blocks to
+     *             disk, update the checksum and show the progress
+     *
+     * @param      pipeline  state of the dump
+     */
+    void dump_sink(DumpPipeline* pipeline);
+
+    /**
+     * @brief      print occupancy and stall counters of the dump pipeline
+     *
+     * @param[in]  pipeline  state of the dump
+     */
+    void print_pipeline_statistics(const DumpPipeline& pipeline) const;
+
+    /**
+     * @brief      start a stream of binary frames and run the stages of the
+     *             pipeline until it has been received or can no longer be
+     *             followed
+     *
+     * @param      pipeline  state of the dump
+     * @param[in]  cmd       command that starts the stream
+     * @param[in]  expected  header the firmware replies with (16 chars)
+     */
+    void stream_frames(DumpPipeline* pipeline, const char* cmd, const char* expected);
+
+    /**
+     * @brief      read the header of a GBA cartridge
+     */
+    void read_gba_header();
+
+    /**
+     * @brief      stream a GBA ROM to disk and request the blocks that
+     *             failed afterwards
+     *
+     * @param[in]  output_file  The output file
+     *
+     * @return     number of bytes read
+     */
+    size_t read_gba_rom(const std::string& output_file);
+
+    /**
+     * @brief      find the size of a GBA ROM; beyond the end of the ROM,
+     *             either the ROM is mirrored or the bus returns the lower 16
+     *             bits of the halfword address
+     *
+     * @return     size of the ROM in bytes
+     */
+    size_t gba_rom_size();
+
+    /**
+     * @brief      read a range of a GBA ROM and request it once more until
+     *             all frames match their checksum
+     *
+     * @param[in]  offset  offset in the ROM (multiple of GBA_UNIT)
+     * @param[in]  len     number of bytes (multiple of GBA_UNIT)
+     * @param      dst     pointer to output buffer
+     */
+    void read_gba(size_t offset, size_t len, uint8_t* dst);
+
+    /*
+     * @brief      read memory using the hex encoded protocol of older firmware
+     *
+     * @param      _addr          starting address
+     * @param      _len           number of bytes to read
+     * @param      buffer         pointer to vector to store data
+     * @param[in]  show_progress  The show progress
+     *
+     * @return     number of bytes read
+     */
+    size_t read_memory_hex(uint16_t _addr, uint16_t _len, std::vector<uint8_t> *buffer, bool show_progress);
+
+    /*
+     * @brief      request a range of memory in binary frames and verify every
+     *             frame against its checksum
+     *
+     * @param[in]  _addr          starting address
+     * @param[in]  _len           number of bytes to read
+     * @param      dst            pointer to output buffer
+     * @param      failed         blocks (offset, length) that were not received
+     * @param[in]  show_progress  whether to show a progress bar
+     */
+    void read_frames(uint16_t _addr, uint16_t _len, uint8_t* dst,
+                     std::vector<std::pair<size_t, size_t>>* failed, bool show_progress);
+
+    /*
+     * @brief      send a command that is answered by a header and binary
+     *             frames and verify every frame against its checksum
+     *
+     * @param[in]  cmd            command word
+     * @param[in]  expected       header the firmware replies with (16 chars)
+     * @param[in]  _len           number of bytes to read
+     * @param      dst            pointer to output buffer
+     * @param      failed         blocks (offset, length) that were not received
+     * @param[in]  show_progress  whether to show a progress bar
+     * @param[in]  compressed     whether the frames are run-length encoded
+     */
+    void receive_frames(const char* cmd, const char* expected, size_t _len, uint8_t* dst,
+                        std::vector<std::pair<size_t, size_t>>* failed, bool show_progress, bool compressed);
+
+    /**
+     * @brief      receive a single binary frame and verify it against its
+     *             checksum
+     *
+     * @param      dst           pointer to output buffer
+     * @param[in]  expected_len  number of (decoded) payload bytes
+     * @param[in]  compressed    whether the payload is run-length encoded
+     * @param      received      incremented by the number of bytes received
+     *
+     * @return     FRAME_VALID, FRAME_CORRUPT or FRAME_LOST
+     */
+    int read_frame(uint8_t* dst, size_t expected_len, bool compressed, size_t* received);
+
+    /**
+     * @brief      decode PackBits run-length encoded data
+     *
+     * @param[in]  src      encoded data
+     * @param[in]  len      number of encoded bytes
+     * @param      dst      output buffer
+     * @param[in]  dst_len  size of the output buffer
+     *
+     * @return     number of decoded bytes or -1 for malformed input
+     */
+    long decode_pack_bits(const uint8_t* src, size_t len, uint8_t* dst, size_t dst_len) const;
+
+    /**
+     * @brief      print the compression ratio of the last read_memory call
+     *
+     * @param[in]  bytes  number of decoded bytes
+     */
+    void print_compression_ratio(size_t bytes) const;
+
+    /**
+     * @brief      write memory in verified blocks, keeping WRITE_WINDOW
+     *             blocks in flight
+     *
+     * @param[in]  _addr          starting address
+     * @param[in]  data           pointer to data
+     * @param[in]  _len           number of bytes to write
+     * @param[in]  show_progress  whether to show a progress bar
+     *
+     * @return     number of bytes written
+     */
+    size_t write_memory(uint16_t _addr, const uint8_t* data, uint16_t _len, bool show_progress = false);
+
+    /**
+     * @brief      write a selection of blocks, keeping WRITE_WINDOW blocks in
+     *             flight
+     *
+     * @param[in]  _addr          starting address
+     * @param[in]  data           pointer to data
+     * @param[in]  _len           number of bytes
+     * @param[in]  blocks         indices of the blocks to write
+     * @param      failed         indices of the blocks that failed
+     * @param[in]  show_progress  whether to show a progress bar
+     */
+    void write_blocks(uint16_t _addr, const uint8_t* data, uint16_t _len,
+                      const std::vector<size_t>& blocks, std::vector<size_t>* failed,
+                      bool show_progress);
+
+    /**
+     * @brief      print the number of retransmissions and, in verbose mode,
+     *             the number of reads on the serial port
+     */
+    void print_transfer_summary() const;
+
     /*
      * @brief      Print information from the ROM header to the screen
      */
@@ -150,6 +764,17 @@ private:
      */
     void print_loadbar(unsigned int x, unsigned int n, unsigned int w = 35);
 
+    /**
+     * @brief      progress bar with the transfer rate and the estimated time
+     *             until the transfer is complete
+     *
+     * @param[in]  x        bytes transferred
+     * @param[in]  n        total number of bytes
+     * @param[in]  seconds  time since the transfer started
+     * @param[in]  w        width of the progress bar
+     */
+    void print_progress(size_t x, size_t n, double seconds, unsigned int w = 35);
+
     /**
      * @brief      Writes a byte.
      *
@@ -0,0 +1,104 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "gba_header.h"
+
+#include <iomanip>
+#include <stdexcept>
+
+/**
+ * @brief      take over the header from the first bytes of a ROM
+ *
+ * @param[in]  rom   at least the first SIZE bytes of the ROM
+ */
+void GbaHeader::parse(const std::vector<uint8_t>& rom) {
+    if(rom.size() < SIZE) {
+        throw std::runtime_error("GBA header is incomplete");
+    }
+
+    this->data.assign(rom.begin(), rom.begin() + SIZE);
+}
+
+/**
+ * @brief      game title (0xA0 - 0xAB) without trailing padding
+ */
+std::string GbaHeader::get_title() const {
+    const std::string title = this->get_string(0xA0, 0xAC);
+    return title.substr(0, title.find_last_not_of(' ') + 1);
+}
+
+/**
+ * @brief      game code (0xAC - 0xAF)
+ */
+std::string GbaHeader::get_game_code() const {
+    return this->get_string(0xAC, 0xB0);
+}
+
+/**
+ * @brief      maker code (0xB0 - 0xB1)
+ */
+std::string GbaHeader::get_maker_code() const {
+    return this->get_string(0xB0, 0xB2);
+}
+
+/**
+ * @brief      complement check over 0xA0 - 0xBC
+ */
+uint8_t GbaHeader::compute_complement() const {
+    uint8_t chk = 0;
+    for(size_t i=0xA0; i<0xBD; i++) {
+        chk -= this->data[i];
+    }
+
+    return chk - 0x19;
+}
+
+/**
+ * @brief      print the contents of the header
+ *
+ * @param      out   output stream
+ */
+void GbaHeader::print(std::ostream& out) const {
+    out << "Cartridge title: " << this->get_title() << std::endl;
+    out << "Game code:       " << this->get_game_code() << std::endl;
+    out << "Maker code:      " << this->get_maker_code() << std::endl;
+    out << "Version:         " << (int)this->get_version() << std::endl;
+    out << "Complement:      0x" << std::hex << std::uppercase << std::setw(2) << std::setfill('0')
+        << (int)this->get_complement() << (this->complement_valid() ? " OK" : " MISMATCH")
+        << std::dec << std::nouppercase << std::setfill(' ') << std::endl;
+}
+
+/**
+ * @brief      printable characters of a range of the header
+ *
+ * @param[in]  begin  first byte
+ * @param[in]  end    one past the last byte
+ */
+std::string GbaHeader::get_string(size_t begin, size_t end) const {
+    std::string str;
+    for(size_t i=begin; i<end; i++) {
+        if(this->data[i] == 0x00) {
+            break;
+        }
+        str += (this->data[i] >= 0x20 && this->data[i] < 0x7F) ? (char)this->data[i] : '?';
+    }
+
+    return str;
+}
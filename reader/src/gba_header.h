@@ -0,0 +1,115 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _GBA_HEADER_H
+#define _GBA_HEADER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      header of a Game Boy Advance ROM (0x00 - 0xBF)
+ *
+ * Unlike on the Game Boy, the header does not list the size of the ROM
+ * nor a checksum over its contents; it only holds the complement check
+ * (0xBD) over the bytes 0xA0 - 0xBC.
+ */
+class GbaHeader {
+private:
+    std::vector<uint8_t> data;
+
+public:
+    static const size_t SIZE = 0xC0;   // bytes in the header
+
+    /**
+     * @brief      default constructor
+     */
+    GbaHeader() {}
+
+    /**
+     * @brief      take over the header from the first bytes of a ROM
+     *
+     * @param[in]  rom   at least the first SIZE bytes of the ROM
+     */
+    void parse(const std::vector<uint8_t>& rom);
+
+    /**
+     * @brief      game title (0xA0 - 0xAB) without trailing padding
+     */
+    std::string get_title() const;
+
+    /**
+     * @brief      game code (0xAC - 0xAF)
+     */
+    std::string get_game_code() const;
+
+    /**
+     * @brief      maker code (0xB0 - 0xB1)
+     */
+    std::string get_maker_code() const;
+
+    /**
+     * @brief      software version (0xBC)
+     */
+    inline uint8_t get_version() const {
+        return this->data[0xBC];
+    }
+
+    /**
+     * @brief      complement check as stored in the header (0xBD)
+     */
+    inline uint8_t get_complement() const {
+        return this->data[0xBD];
+    }
+
+    /**
+     * @brief      complement check over 0xA0 - 0xBC
+     */
+    uint8_t compute_complement() const;
+
+    /**
+     * @brief      whether the complement check matches, which tells whether
+     *             the cartridge is read correctly
+     */
+    inline bool complement_valid() const {
+        return this->compute_complement() == this->get_complement();
+    }
+
+    /**
+     * @brief      print the contents of the header
+     *
+     * @param      out   output stream
+     */
+    void print(std::ostream& out) const;
+
+private:
+    /**
+     * @brief      printable characters of a range of the header
+     *
+     * @param[in]  begin  first byte
+     * @param[in]  end    one past the last byte
+     */
+    std::string get_string(size_t begin, size_t end) const;
+};
+
+#endif
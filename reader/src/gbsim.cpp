@@ -0,0 +1,133 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include <string>
+#include <iostream>
+#include <csignal>
+#include <cstdio>
+#include <unistd.h>
+#include <tclap/CmdLine.h>
+
+#include "cartridge_sim.h"
+#include "firmware_sim.h"
+
+/*
+ * Simulator of a reader with a cartridge inserted. The firmware is emulated
+ * behind a pseudo-terminal that gbcr opens like a serial port, for instance
+ *
+ *   gbsim --rom game.gb --link /tmp/gbsim0 &
+ *   gbcr -p /tmp/gbsim0 -o dump.gb
+ *
+ * such that the reader can be tested and its protocol measured without any
+ * hardware.
+ */
+
+/**
+ * @brief      stop the simulator upon SIGINT or SIGTERM
+ */
+static void handle_signal(int) {
+    FirmwareSim::stop();
+}
+
+int main(int argc, char** argv) {
+    std::string link;
+
+    try {
+        TCLAP::CmdLine cmd("Simulate a gameboy cartridge reader.", ' ', "0.3");
+
+        // cartridge contents
+        TCLAP::ValueArg<std::string> arg_rom("r","rom","ROM image (i.e. rom.gb)",true,"","filename");
+        cmd.add(arg_rom);
+
+        // SRAM contents, loaded upon start and stored upon exit
+        TCLAP::ValueArg<std::string> arg_save("s","save","Save file for the SRAM (i.e. rom.sav)",false,"","filename");
+        cmd.add(arg_save);
+
+        // fixed name for the port
+        TCLAP::ValueArg<std::string> arg_link("l","link","Create a symbolic link to the port (i.e. /tmp/gbsim0)",false,"","path");
+        cmd.add(arg_link);
+
+        // highest baud rate the firmware reports
+        TCLAP::ValueArg<unsigned int> arg_baud("b","baud","Maximum baud rate (i.e. 1000000)",false,2000000,"baud");
+        cmd.add(arg_baud);
+
+        // whether to send replies as fast as possible
+        TCLAP::SwitchArg arg_unthrottled("u","unthrottled","do not limit replies to the baud rate",false);
+        cmd.add(arg_unthrottled);
+
+        // whether to emulate a GBA cartridge
+        TCLAP::SwitchArg arg_gba("g","gba","emulate a GBA cartridge",false);
+        cmd.add(arg_gba);
+
+        // whether to emulate the firmware that only has the hex protocol
+        TCLAP::SwitchArg arg_legacy("x","legacy","legacy (hex) protocol only",false);
+        cmd.add(arg_legacy);
+
+        cmd.parse(argc, argv);
+
+        CartridgeSim cartridge(arg_rom.getValue());
+        if(arg_save.isSet()) {
+            cartridge.load_ram(arg_save.getValue());
+        }
+
+        FirmwareSim firmware(cartridge, arg_baud.getValue(), !arg_unthrottled.getValue(),
+                             arg_gba.getValue(), arg_legacy.getValue());
+
+        if(arg_link.isSet()) {
+            link = arg_link.getValue();
+            unlink(link.c_str());
+            if(symlink(firmware.get_port().c_str(), link.c_str()) != 0) {
+                throw std::runtime_error("Could not create link " + link);
+            }
+        }
+
+        signal(SIGINT, handle_signal);
+        signal(SIGTERM, handle_signal);
+
+        if(arg_gba.getValue()) {
+            std::cout << "Cartridge: GBA, " << cartridge.get_rom_size() / 1024 << " KByte ROM" << std::endl;
+        } else {
+            std::cout << "Cartridge: " << cartridge.describe() << std::endl;
+        }
+        std::cout << "Port: " << (link.empty() ? firmware.get_port() : link) << std::endl;
+
+        firmware.run();
+
+        if(arg_save.isSet()) {
+            cartridge.save_ram(arg_save.getValue());
+        }
+        if(!link.empty()) {
+            unlink(link.c_str());
+        }
+
+        return 0;
+
+    } catch (TCLAP::ArgException &e) {
+        std::cerr << "error: " << e.error() <<
+                     " for arg " << e.argId() << std::endl;
+        return -1;
+    } catch (std::exception &e) {
+        if(!link.empty()) {
+            unlink(link.c_str());
+        }
+        std::cerr << "error: " << e.what() << std::endl;
+        return -1;
+    }
+}
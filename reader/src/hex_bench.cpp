@@ -0,0 +1,159 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+
+#include "hex_decode.h"
+
+/*
+ * Benchmark of the hex decoders against the per-pair strtoul decoding that
+ * the hex protocol originally used. Run without arguments to decode random
+ * data, or pass a file with recorded hex characters (e.g. a capture of a
+ * legacy transfer without the ADDR and SIZE lines).
+ */
+
+/**
+ * @brief      decode a pair of characters at a time using strtoul
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     len
+ */
+static size_t hex_decode_strtoul(const uint8_t* src, size_t len, uint8_t* dst) {
+    char c[3];
+    c[2] = '\0';
+    for(size_t i=0; i+1<len; i+=2) {
+        c[0] = src[i];
+        c[1] = src[i+1];
+        dst[i/2] = strtoul(c, NULL, 16);
+    }
+
+    return len;
+}
+
+/**
+ * @brief      time a decoder and verify its output
+ *
+ * @param[in]  name       name of the decoder
+ * @param[in]  decode     decoder
+ * @param[in]  input      hex characters
+ * @param[in]  reference  expected output
+ * @param[in]  rounds     number of times to decode the input
+ */
+static void run(const std::string& name, size_t (*decode)(const uint8_t*, size_t, uint8_t*),
+                const std::vector<uint8_t>& input, const std::vector<uint8_t>& reference,
+                unsigned int rounds) {
+    std::vector<uint8_t> output(input.size() / 2);
+
+    auto start = std::chrono::steady_clock::now();
+    for(unsigned int i=0; i<rounds; i++) {
+        decode(input.data(), input.size(), output.data());
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end - start;
+
+    const double mb = (double)input.size() * rounds / (1024.0 * 1024.0);
+    std::cout << std::setw(8) << name << ": " << std::fixed << std::setprecision(1)
+              << std::setw(8) << (mb / elapsed_seconds.count()) << " MB/s"
+              << (output == reference ? "" : "  (OUTPUT MISMATCH)") << std::endl;
+}
+
+/**
+ * @brief      verify that a decoder reports the first malformed character
+ *
+ * @param[in]  name    name of the decoder
+ * @param[in]  decode  decoder
+ * @param[in]  input   valid hex characters
+ *
+ * @return     whether every malformed offset was reported correctly
+ */
+static bool check_offsets(const std::string& name, size_t (*decode)(const uint8_t*, size_t, uint8_t*),
+                          const std::vector<uint8_t>& input) {
+    const size_t len = std::min<size_t>(input.size(), 256);
+    std::vector<uint8_t> output(len / 2);
+
+    for(size_t pos=0; pos<len; pos++) {
+        for(uint8_t bad : {(uint8_t)'g', (uint8_t)'/', (uint8_t)':', (uint8_t)'@', (uint8_t)0xB0}) {
+            std::vector<uint8_t> corrupt(input.begin(), input.begin() + len);
+            corrupt[pos] = bad;
+            if(decode(corrupt.data(), len, output.data()) != pos) {
+                std::cout << name << ": malformed character at " << pos << " not reported" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint8_t> input;
+
+    if(argc > 1) {
+        std::ifstream in(argv[1], std::ios::binary);
+        if(!in) {
+            std::cerr << "error: cannot open " << argv[1] << std::endl;
+            return -1;
+        }
+        input.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        input.resize(input.size() & ~(size_t)1);
+    } else {
+        const char digits[] = "0123456789ABCDEFabcdef";
+        std::mt19937 rng(42);
+        input.resize(16 * 1024 * 1024);
+        for(auto& c : input) {
+            c = digits[rng() % 22];
+        }
+    }
+
+    std::vector<uint8_t> reference(input.size() / 2);
+    const size_t offset = hex_decode_scalar(input.data(), input.size(), reference.data());
+    if(offset != input.size()) {
+        std::cerr << "error: malformed character at offset " << offset << std::endl;
+        return -1;
+    }
+
+    const unsigned int rounds = std::max<size_t>(1, (64 * 1024 * 1024) / std::max<size_t>(input.size(), 1));
+    std::cout << "Decoding " << input.size() << " characters " << rounds << " times" << std::endl;
+
+    bool valid = check_offsets("scalar", hex_decode_scalar, input);
+    run("strtoul", hex_decode_strtoul, input, reference, rounds);
+    run("scalar", hex_decode_scalar, input, reference, rounds);
+#if defined(__x86_64__) || defined(__i386__)
+    valid = check_offsets("sse2", hex_decode_sse2, input) && valid;
+    run("sse2", hex_decode_sse2, input, reference, rounds);
+    if(__builtin_cpu_supports("avx2")) {
+        valid = check_offsets("avx2", hex_decode_avx2, input) && valid;
+        run("avx2", hex_decode_avx2, input, reference, rounds);
+    }
+#endif
+
+    return valid ? 0 : -1;
+}
@@ -0,0 +1,217 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "hex_decode.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief      value of a hexadecimal character
+ *
+ * @param[in]  c     character
+ *
+ * @return     value (0 - 15) or -1 for an invalid character
+ */
+static inline int hex_value(uint8_t c) {
+    if(c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if(c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if(c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief      decode hexadecimal characters, using the fastest
+ *             implementation supported by the processor
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+size_t hex_decode(const uint8_t* src, size_t len, uint8_t* dst) {
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if(has_avx2) {
+        return hex_decode_avx2(src, len, dst);
+    }
+    return hex_decode_sse2(src, len, dst);
+#else
+    return hex_decode_scalar(src, len, dst);
+#endif
+}
+
+/**
+ * @brief      decode hexadecimal characters one pair at a time
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+size_t hex_decode_scalar(const uint8_t* src, size_t len, uint8_t* dst) {
+    for(size_t i=0; i+1<len; i+=2) {
+        const int hi = hex_value(src[i]);
+        if(hi < 0) {
+            return i;
+        }
+        const int lo = hex_value(src[i+1]);
+        if(lo < 0) {
+            return i + 1;
+        }
+        dst[i/2] = (hi << 4) | lo;
+    }
+
+    return len;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * Both vectorized decoders convert every character to its value in
+ * parallel: digits are offset by '0', letters (after folding to lower case)
+ * by 'a' - 10. Characters outside both ranges, including those above 0x7F
+ * which are negative as signed bytes, clear their bit in the validity mask.
+ * Pairs of values are then combined in 16-bit lanes and packed into bytes.
+ * A block with an invalid character is handed to the scalar decoder, which
+ * reports the exact offset.
+ */
+
+/**
+ * @brief      decode hexadecimal characters 32 at a time using SSE2
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+size_t hex_decode_sse2(const uint8_t* src, size_t len, uint8_t* dst) {
+    const __m128i digit_lo = _mm_set1_epi8('0' - 1);
+    const __m128i digit_hi = _mm_set1_epi8('9' + 1);
+    const __m128i alpha_lo = _mm_set1_epi8('a' - 1);
+    const __m128i alpha_hi = _mm_set1_epi8('f' + 1);
+    const __m128i digit_offset = _mm_set1_epi8('0');
+    const __m128i alpha_offset = _mm_set1_epi8('a' - 10);
+    const __m128i lower_case = _mm_set1_epi8(0x20);
+    const __m128i low_byte = _mm_set1_epi16(0x00FF);
+
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32) {
+        __m128i values[2];
+        int valid = 0;
+
+        for(unsigned int j=0; j<2; j++) {
+            const __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 16 * j));
+            const __m128i lc = _mm_or_si128(c, lower_case);
+
+            const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, digit_lo), _mm_cmplt_epi8(c, digit_hi));
+            const __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lc, alpha_lo), _mm_cmplt_epi8(lc, alpha_hi));
+
+            const __m128i v = _mm_or_si128(_mm_and_si128(is_digit, _mm_sub_epi8(c, digit_offset)),
+                                           _mm_and_si128(is_alpha, _mm_sub_epi8(lc, alpha_offset)));
+
+            // combine the high (even) and low (odd) nibbles of every pair
+            values[j] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, low_byte), 4), _mm_srli_epi16(v, 8));
+            valid |= _mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) << (16 * j);
+        }
+
+        if(valid != (int)0xFFFFFFFF) {
+            break;
+        }
+
+        _mm_storeu_si128((__m128i*)(dst + i / 2), _mm_packus_epi16(values[0], values[1]));
+    }
+
+    const size_t offset = hex_decode_scalar(src + i, len - i, dst + i / 2);
+    return i + offset;
+}
+
+/**
+ * @brief      decode hexadecimal characters 64 at a time using AVX2; only
+ *             call this when the processor supports AVX2
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+__attribute__((target("avx2")))
+size_t hex_decode_avx2(const uint8_t* src, size_t len, uint8_t* dst) {
+    const __m256i digit_lo = _mm256_set1_epi8('0' - 1);
+    const __m256i digit_hi = _mm256_set1_epi8('9' + 1);
+    const __m256i alpha_lo = _mm256_set1_epi8('a' - 1);
+    const __m256i alpha_hi = _mm256_set1_epi8('f' + 1);
+    const __m256i digit_offset = _mm256_set1_epi8('0');
+    const __m256i alpha_offset = _mm256_set1_epi8('a' - 10);
+    const __m256i lower_case = _mm256_set1_epi8(0x20);
+    const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+
+    size_t i = 0;
+    for(; i + 64 <= len; i += 64) {
+        __m256i values[2];
+        bool valid = true;
+
+        for(unsigned int j=0; j<2; j++) {
+            const __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 32 * j));
+            const __m256i lc = _mm256_or_si256(c, lower_case);
+
+            const __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, digit_lo),
+                                                      _mm256_cmpgt_epi8(digit_hi, c));
+            const __m256i is_alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lc, alpha_lo),
+                                                      _mm256_cmpgt_epi8(alpha_hi, lc));
+
+            const __m256i v = _mm256_or_si256(_mm256_and_si256(is_digit, _mm256_sub_epi8(c, digit_offset)),
+                                              _mm256_and_si256(is_alpha, _mm256_sub_epi8(lc, alpha_offset)));
+
+            // combine the high (even) and low (odd) nibbles of every pair
+            values[j] = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(v, low_byte), 4),
+                                        _mm256_srli_epi16(v, 8));
+            valid = valid && _mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) == -1;
+        }
+
+        if(!valid) {
+            break;
+        }
+
+        // packing works per 128-bit lane; restore the order of the quadwords
+        const __m256i packed = _mm256_packus_epi16(values[0], values[1]);
+        _mm256_storeu_si256((__m256i*)(dst + i / 2), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+
+    const size_t offset = hex_decode_scalar(src + i, len - i, dst + i / 2);
+    return i + offset;
+}
+
+#endif
@@ -0,0 +1,79 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _HEX_DECODE_H
+#define _HEX_DECODE_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      decode hexadecimal characters into bytes, using the fastest
+ *             implementation supported by the processor
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+size_t hex_decode(const uint8_t* src, size_t len, uint8_t* dst);
+
+/**
+ * @brief      decode hexadecimal characters one pair at a time
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+size_t hex_decode_scalar(const uint8_t* src, size_t len, uint8_t* dst);
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * @brief      decode hexadecimal characters 32 at a time using SSE2
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+size_t hex_decode_sse2(const uint8_t* src, size_t len, uint8_t* dst);
+
+/**
+ * @brief      decode hexadecimal characters 64 at a time using AVX2; only
+ *             call this when the processor supports AVX2
+ *
+ * @param[in]  src   pointer to characters
+ * @param[in]  len   number of characters (even)
+ * @param      dst   pointer to output buffer (len / 2 bytes)
+ *
+ * @return     offset of the first malformed character or len when all
+ *             characters are valid
+ */
+size_t hex_decode_avx2(const uint8_t* src, size_t len, uint8_t* dst);
+#endif
+
+#endif
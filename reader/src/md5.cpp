@@ -0,0 +1,159 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "md5.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+const uint32_t K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+const unsigned int R[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+inline uint32_t rotl(uint32_t x, unsigned int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+}
+
+/**
+ * @brief      default constructor
+ */
+Md5::Md5() :
+    state{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476} {}
+
+/**
+ * @brief      process a single 64 byte block
+ *
+ * @param[in]  data  pointer to block
+ */
+void Md5::transform(const uint8_t* data) {
+    uint32_t m[16];
+    for(unsigned int i=0; i<16; i++) {
+        m[i] = data[4*i] | ((uint32_t)data[4*i+1] << 8) | ((uint32_t)data[4*i+2] << 16) |
+               ((uint32_t)data[4*i+3] << 24);
+    }
+
+    uint32_t a = this->state[0], b = this->state[1], c = this->state[2], d = this->state[3];
+    for(unsigned int i=0; i<64; i++) {
+        uint32_t f;
+        unsigned int g;
+        if(i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if(i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if(i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+
+        f += a + K[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b += rotl(f, R[i]);
+    }
+
+    this->state[0] += a;
+    this->state[1] += b;
+    this->state[2] += c;
+    this->state[3] += d;
+}
+
+/**
+ * @brief      hash data
+ *
+ * @param[in]  data  pointer to data
+ * @param[in]  len   number of bytes
+ */
+void Md5::update(const uint8_t* data, size_t len) {
+    this->total_len += len;
+
+    // complete a partially filled block first
+    if(this->block_len > 0) {
+        const size_t n = std::min(len, sizeof(this->block) - this->block_len);
+        memcpy(this->block + this->block_len, data, n);
+        this->block_len += n;
+        data += n;
+        len -= n;
+        if(this->block_len < sizeof(this->block)) {
+            return;
+        }
+        this->transform(this->block);
+        this->block_len = 0;
+    }
+
+    for(; len >= sizeof(this->block); data += sizeof(this->block), len -= sizeof(this->block)) {
+        this->transform(data);
+    }
+
+    memcpy(this->block, data, len);
+    this->block_len = len;
+}
+
+/**
+ * @brief      finish the hash
+ *
+ * @return     digest as 32 lower case hex characters
+ */
+std::string Md5::hexdigest() {
+    const uint64_t bits = this->total_len * 8;
+
+    // pad with 0x80, zeros and the message length in bits (little endian)
+    uint8_t padding[72] = {0x80};
+    const size_t pad_len = (this->block_len < 56 ? 56 : 120) - this->block_len;
+    for(unsigned int i=0; i<8; i++) {
+        padding[pad_len + i] = (uint8_t)(bits >> (8 * i));
+    }
+    this->update(padding, pad_len + 8);
+
+    static const char digits[] = "0123456789abcdef";
+    std::string digest;
+    for(unsigned int i=0; i<4; i++) {
+        for(unsigned int j=0; j<32; j+=8) {
+            const uint8_t byte = this->state[i] >> j;
+            digest += digits[byte >> 4];
+            digest += digits[byte & 0x0F];
+        }
+    }
+
+    return digest;
+}
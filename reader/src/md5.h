@@ -0,0 +1,67 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _MD5_H
+#define _MD5_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      streaming MD5 (RFC 1321)
+ */
+class Md5 {
+private:
+    uint32_t state[4];
+    uint8_t block[64];              // partially filled block
+    size_t block_len = 0;
+    uint64_t total_len = 0;         // bytes hashed so far
+
+    /**
+     * @brief      process a single 64 byte block
+     *
+     * @param[in]  data  pointer to block
+     */
+    void transform(const uint8_t* data);
+
+public:
+    /**
+     * @brief      default constructor
+     */
+    Md5();
+
+    /**
+     * @brief      hash data
+     *
+     * @param[in]  data  pointer to data
+     * @param[in]  len   number of bytes
+     */
+    void update(const uint8_t* data, size_t len);
+
+    /**
+     * @brief      finish the hash
+     *
+     * @return     digest as 32 lower case hex characters
+     */
+    std::string hexdigest();
+};
+
+#endif
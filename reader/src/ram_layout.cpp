@@ -0,0 +1,111 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "ram_layout.h"
+
+#include <sstream>
+
+/**
+ * @brief      default constructor
+ *
+ * @param[in]  cartridge_type  cartridge type (0x147 in the header)
+ * @param[in]  ram_size        RAM size (0x149 in the header)
+ */
+RamLayout::RamLayout(uint8_t cartridge_type, uint8_t ram_size) {
+    switch(cartridge_type) {
+        case 0x02:  // MBC1+RAM
+        case 0x03:  // MBC1+RAM+BATTERY
+            this->controller = RAM_MBC1;
+        break;
+        case 0x05:  // MBC2
+        case 0x06:  // MBC2+BATTERY
+            // the RAM is part of the controller and not listed in 0x149
+            this->controller = RAM_MBC2;
+            this->banks = 1;
+            this->bank_size = 0x200;
+            return;
+        case 0x08:  // ROM+RAM
+        case 0x09:  // ROM+RAM+BATTERY
+            this->controller = RAM_PLAIN;
+        break;
+        case 0x10:  // MBC3+TIMER+RAM+BATTERY
+        case 0x12:  // MBC3+RAM
+        case 0x13:  // MBC3+RAM+BATTERY
+            this->controller = RAM_MBC3;
+        break;
+        case 0x1A:  // MBC5+RAM
+        case 0x1B:  // MBC5+RAM+BATTERY
+        case 0x1D:  // MBC5+RUMBLE+RAM
+        case 0x1E:  // MBC5+RUMBLE+RAM+BATTERY
+            this->controller = RAM_MBC5;
+        break;
+        default:
+            return;
+    }
+
+    switch(ram_size) {
+        case 0x01:
+            this->banks = 1;
+            this->bank_size = 0x800;
+        break;
+        case 0x02:
+            this->banks = 1;
+            this->bank_size = 0x2000;
+        break;
+        case 0x03:
+            this->banks = 4;
+            this->bank_size = 0x2000;
+        break;
+        case 0x04:
+            this->banks = 16;
+            this->bank_size = 0x2000;
+        break;
+        case 0x05:
+            this->banks = 8;
+            this->bank_size = 0x2000;
+        break;
+        default:
+            this->controller = RAM_NONE;
+        break;
+    }
+}
+
+/**
+ * @brief      human readable description of the RAM
+ */
+std::string RamLayout::describe() const {
+    if(!this->has_ram()) {
+        return "None";
+    }
+
+    std::stringstream str;
+    if(this->get_size() < 1024) {
+        str << this->get_size() << " Byte";
+    } else {
+        str << this->get_size() / 1024 << " KByte";
+    }
+    if(this->is_nibble()) {
+        str << " (4 bit)";
+    } else if(this->banks > 1) {
+        str << " (" << this->banks << " banks)";
+    }
+
+    return str.str();
+}
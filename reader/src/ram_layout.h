@@ -0,0 +1,122 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _RAM_LAYOUT_H
+#define _RAM_LAYOUT_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      describes the external RAM of a cartridge and how it is
+ *             accessed, based on the cartridge type (0x147) and RAM size
+ *             (0x149) in the header
+ *
+ * The RAM is always visible at 0xA000. MBC1, MBC3 and MBC5 cartridges
+ * have to enable it by writing 0x0A to 0x0000-0x1FFF and select a bank
+ * by writing to 0x4000-0x5FFF; MBC1 only does so in RAM banking mode.
+ * MBC2 has 512 x 4 bits of RAM inside the controller, of which the upper
+ * four bits of every byte are undefined. Cartridges without a controller
+ * map their RAM directly.
+ */
+class RamLayout {
+public:
+    // memory bank controller that drives the RAM
+    enum Controller {
+        RAM_NONE,           // cartridge has no external RAM
+        RAM_PLAIN,          // ROM+RAM, no controller
+        RAM_MBC1,
+        RAM_MBC2,
+        RAM_MBC3,
+        RAM_MBC5,
+    };
+
+private:
+    Controller controller = RAM_NONE;
+    size_t banks = 0;               // number of RAM banks
+    size_t bank_size = 0;           // bytes per RAM bank
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param[in]  cartridge_type  cartridge type (0x147 in the header)
+     * @param[in]  ram_size        RAM size (0x149 in the header)
+     */
+    RamLayout(uint8_t cartridge_type, uint8_t ram_size);
+
+    /**
+     * @brief      controller that drives the RAM
+     */
+    inline Controller get_controller() const {
+        return this->controller;
+    }
+
+    /**
+     * @brief      number of RAM banks
+     */
+    inline size_t get_banks() const {
+        return this->banks;
+    }
+
+    /**
+     * @brief      bytes per RAM bank
+     */
+    inline size_t get_bank_size() const {
+        return this->bank_size;
+    }
+
+    /**
+     * @brief      total number of bytes of RAM
+     */
+    inline size_t get_size() const {
+        return this->banks * this->bank_size;
+    }
+
+    /**
+     * @brief      whether the cartridge has any RAM
+     */
+    inline bool has_ram() const {
+        return this->get_size() > 0;
+    }
+
+    /**
+     * @brief      whether the RAM has to be enabled before it is accessed
+     */
+    inline bool needs_enable() const {
+        return this->controller != RAM_PLAIN && this->controller != RAM_NONE;
+    }
+
+    /**
+     * @brief      whether the RAM holds only the lower four bits of every
+     *             byte
+     */
+    inline bool is_nibble() const {
+        return this->controller == RAM_MBC2;
+    }
+
+    /**
+     * @brief      human readable description of the RAM
+     */
+    std::string describe() const;
+};
+
+#endif
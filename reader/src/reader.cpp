@@ -23,9 +23,20 @@
 #include <vector>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <chrono>
 #include <tclap/CmdLine.h>
 
-#include "gameboy_cartridge.h"
+#include "device_job.h"
+#include "reader_daemon.h"
+#include "rom_verifier.h"
+#include "dat_index.h"
+
+// exit code of a dump that fails the header or global checksum
+static const int EXIT_CHECKSUM = 2;
 
 int main(int argc, char** argv) {
     try {
@@ -33,11 +44,14 @@ int main(int argc, char** argv) {
         TCLAP::CmdLine cmd("Read or write to gameboy cartridge.", ' ', "0.3");
 
         // output file
-        TCLAP::ValueArg<std::string> arg_output_filename("o","output","Output file (i.e. rom.gb)",true,"__NONE__","filename");
-        cmd.add(arg_output_filename);
+        TCLAP::ValueArg<std::string> arg_output_filename("o","output","Output file (i.e. rom.gb or {title}.gb)",true,"__NONE__","filename");
+
+        // keep the ports open and accept jobs on a socket instead
+        TCLAP::ValueArg<std::string> arg_daemon("d","daemon","Accept jobs on a Unix socket (i.e. /tmp/gbcr.sock)",true,"__NONE__","socket");
+        cmd.xorAdd(arg_output_filename, arg_daemon);
 
         // port
-        TCLAP::ValueArg<std::string> arg_port("p","port","Port (i.e. /dev/ttyUSB1)",true,"__NONE__","port");
+        TCLAP::MultiArg<std::string> arg_port("p","port","Port (i.e. /dev/ttyUSB1); repeat to use several readers",true,"port");
         cmd.add(arg_port);
 
         // whether to store ram
@@ -48,26 +62,142 @@ int main(int argc, char** argv) {
         TCLAP::SwitchArg arg_load("l","load","load",false);
         cmd.add(arg_load);
 
+        // whether to use the hex protocol of older firmware
+        TCLAP::SwitchArg arg_legacy("x","legacy","legacy (hex) protocol",false);
+        cmd.add(arg_legacy);
+
+        // whether to request run-length encoded transfers
+        TCLAP::SwitchArg arg_compress("c","compress","compress transfers",false);
+        cmd.add(arg_compress);
+
+        // whether to only measure the cycles per read of the firmware
+        TCLAP::SwitchArg arg_bench("B","bench","measure cycles per byte read",false);
+        cmd.add(arg_bench);
+
+        // whether to continue an interrupted dump
+        TCLAP::SwitchArg arg_resume("","resume","resume an interrupted dump",false);
+        cmd.add(arg_resume);
+
+        // whether to print statistics on the serial link
+        TCLAP::SwitchArg arg_verbose("","verbose","print link statistics",false);
+        cmd.add(arg_verbose);
+
+        // keep dumps in a store and skip dumping cartridges it already holds
+        TCLAP::ValueArg<std::string> arg_store("s","store","ROM store directory (i.e. ~/gbcr-store)",false,"","directory");
+        cmd.add(arg_store);
+
+        // catalogue to identify dumps with
+        TCLAP::ValueArg<std::string> arg_dat("","dat","DAT file to look dumps up in (i.e. no-intro.dat)",false,"","file");
+        cmd.add(arg_dat);
+
+        // whether to read GBA cartridges
+        TCLAP::SwitchArg arg_gba("g","gba","read GBA cartridges",false);
+        cmd.add(arg_gba);
+
+        // highest baud rate to negotiate
+        TCLAP::ValueArg<unsigned int> arg_baud("b","baud","Maximum baud rate (i.e. 1000000)",false,2000000,"baud");
+        cmd.add(arg_baud);
+
         cmd.parse(argc, argv);
 
-        const std::string port_url = arg_port.getValue();
+        const std::vector<std::string> ports = arg_port.getValue();
         const std::string filename = arg_output_filename.getValue();
         const bool ram = arg_ram.getValue();
         const bool load = arg_load.getValue();
+        const bool bench = arg_bench.getValue();
+
+        DeviceOptions options;
+        options.legacy = arg_legacy.getValue();
+        options.baud = arg_baud.getValue();
+        options.compress = arg_compress.getValue();
+        options.verbose = arg_verbose.getValue();
+        options.resume = arg_resume.getValue();
+        options.store = arg_store.getValue();
+        options.gba = arg_gba.getValue();
+
+        int type = DeviceJob::JOB_READ_ROM;
+        if(bench) {
+            type = DeviceJob::JOB_BENCHMARK;
+        } else if(ram && !load) {
+            type = DeviceJob::JOB_READ_RAM;
+        } else if(load) {
+            type = DeviceJob::JOB_LOAD_RAM;
+        }
 
         std::cout << "=========================================" << std::endl;
         std::cout << "GameBoyCartridgeReader v.0.3 by Ivo Filot" << std::endl;
         std::cout << "=========================================" << std::endl;
 
-        GameboyCartridge gbc(port_url);
-        gbc.init();
+        std::unique_ptr<DatIndex> dat;
+        if(arg_dat.isSet()) {
+            dat.reset(new DatIndex(arg_dat.getValue()));
+            options.dat = dat.get();
+            std::cout << "Loaded " << dat->get_size() << " ROMs from " << arg_dat.getValue() << std::endl;
+        }
 
-        if(ram && !load) {
-            gbc.read_ram(filename);
-        } else if(load) {
-            gbc.load_ram(filename);
+        if(arg_daemon.isSet()) {
+            ReaderDaemon daemon(arg_daemon.getValue(), ports, options);
+            daemon.run();
+            return 0;
+        }
+
+        OutputNames names;
+        std::vector<DeviceJob> jobs;
+        for(const auto& port_url : ports) {
+            jobs.emplace_back(port_url, type, filename, options);
+        }
+
+        if(jobs.size() == 1) {
+            jobs[0].run(&std::cout, &names);
+            if(jobs[0].failed_checksum()) {
+                throw ChecksumError(jobs[0].get_error());
+            } else if(jobs[0].failed()) {
+                throw std::runtime_error(jobs[0].get_error());
+            }
         } else {
-            gbc.read_rom(filename);
+            // every board is driven by its own thread; the progress messages
+            // of a board are kept aside and the outcome is reported as soon
+            // as it has finished
+            auto start = std::chrono::system_clock::now();
+            std::mutex mtx;
+            std::vector<std::thread> threads;
+            for(auto& job : jobs) {
+                threads.emplace_back([&job, &names, &mtx, &options]() {
+                    std::stringstream console;
+                    job.run(&console, &names);
+
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if(options.verbose || job.failed()) {
+                        std::cout << console.str() << std::endl;
+                    }
+                    std::cout << job.summary() << std::endl;
+                });
+            }
+            for(auto& thread : threads) {
+                thread.join();
+            }
+
+            std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - start;
+            size_t bytes = 0;
+            unsigned int failed = 0;
+            unsigned int failed_checksum = 0;
+            for(const auto& job : jobs) {
+                bytes += job.get_bytes();
+                failed += job.failed() ? 1 : 0;
+                failed_checksum += job.failed_checksum() ? 1 : 0;
+            }
+
+            std::cout << "=========================================" << std::endl;
+            std::cout << "Transferred " << bytes << " bytes with " << jobs.size() - failed << " of "
+                      << jobs.size() << " readers in " << std::fixed << std::setprecision(1)
+                      << elapsed_seconds.count() << " s ("
+                      << bytes / 1024.0 / elapsed_seconds.count() << " KB/s)" << std::endl;
+
+            if(failed > failed_checksum) {
+                throw std::runtime_error(std::to_string(failed) + " reader(s) failed");
+            } else if(failed > 0) {
+                throw ChecksumError(std::to_string(failed) + " dump(s) failed their checksums");
+            }
         }
 
         // end of program
@@ -80,5 +210,13 @@ int main(int argc, char** argv) {
         std::cerr << "error: " << e.error() <<
                      " for arg " << e.argId() << std::endl;
         return -1;
+    } catch (ChecksumError &e) {
+        // a complete dump that does not match its header gets its own exit
+        // code, such that scripts can tell it apart from a failed transfer
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_CHECKSUM;
+    } catch (std::exception &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return -1;
     }
 }
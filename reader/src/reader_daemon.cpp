@@ -0,0 +1,314 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "reader_daemon.h"
+#include "gameboy_cartridge.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <unistd.h>
+
+/**
+ * @brief      default constructor
+ *
+ * @param[in]  _callback  receives every line
+ */
+LineStreambuf::LineStreambuf(const std::function<void(const std::string&)>& _callback) :
+    callback(_callback) {}
+
+int LineStreambuf::overflow(int c) {
+    if(c == traits_type::eof()) {
+        return traits_type::not_eof(c);
+    }
+
+    if(c == '\n' || c == '\r') {
+        if(!this->line.empty()) {
+            this->callback(this->line);
+            this->line.clear();
+        }
+    } else {
+        this->line += (char)c;
+    }
+
+    return c;
+}
+
+/**
+ * @brief      default constructor
+ *
+ * @param      io    io service of the daemon
+ */
+DaemonClient::DaemonClient(boost::asio::io_service& io) :
+    socket(io) {}
+
+/**
+ * @brief      send a single line; a client that has disconnected is
+ *             silently ignored, its jobs keep running
+ *
+ * @param[in]  line  line without newline
+ */
+void DaemonClient::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    boost::system::error_code ec;
+    boost::asio::write(this->socket, boost::asio::buffer(line + "\n"), ec);
+}
+
+/**
+ * @brief      default constructor
+ *
+ * @param[in]  _socket_path  path of the Unix domain socket
+ * @param[in]  ports         paths to the serial ports
+ * @param[in]  _options      settings of the boards
+ */
+ReaderDaemon::ReaderDaemon(const std::string& _socket_path, const std::vector<std::string>& ports,
+                           const DeviceOptions& _options) :
+    socket_path(_socket_path),
+    options(_options),
+    next_id(1) {
+
+    for(const auto& port_url : ports) {
+        this->devices.emplace_back(new DaemonDevice(port_url));
+    }
+}
+
+/**
+ * @brief      connect to the boards and serve clients until the process is
+ *             terminated
+ */
+void ReaderDaemon::run() {
+    // a socket left behind by an earlier daemon would block the bind
+    ::unlink(this->socket_path.c_str());
+    boost::asio::local::stream_protocol::acceptor acceptor(this->io,
+        boost::asio::local::stream_protocol::endpoint(this->socket_path));
+
+    for(auto& device : this->devices) {
+        device->worker = std::thread(&ReaderDaemon::device_worker, this, device.get());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->console_mtx);
+        std::cout << "Accepting jobs on " << this->socket_path << std::endl;
+    }
+
+    while(true) {
+        std::shared_ptr<DaemonClient> client(new DaemonClient(this->io));
+        acceptor.accept(client->get_socket());
+        std::thread(&ReaderDaemon::serve_client, this, client).detach();
+    }
+}
+
+/**
+ * @brief      connect to a board and run the jobs in its queue
+ *
+ * @param      device  board
+ */
+void ReaderDaemon::device_worker(DaemonDevice* device) {
+    // progress messages go to the client of the running job; messages while
+    // connecting go to the console of the daemon
+    std::shared_ptr<DaemonJob> current;
+    LineStreambuf buffer([this, device, &current](const std::string& line) {
+        if(current) {
+            current->client->send("progress " + std::to_string(current->id) + " " + line);
+        } else {
+            std::lock_guard<std::mutex> lock(this->console_mtx);
+            std::cout << "[" << device->port_url << "] " << line << std::endl;
+        }
+    });
+    std::ostream console(&buffer);
+
+    std::unique_ptr<GameboyCartridge> gbc;
+    try {
+        gbc.reset(new GameboyCartridge(device->port_url));
+        gbc->set_console(&console);
+        gbc->set_legacy_protocol(this->options.legacy);
+        gbc->set_max_baud_rate(this->options.baud);
+        gbc->set_compressed_read(this->options.compress);
+        gbc->set_verbose(this->options.verbose);
+        gbc->set_gba_mode(this->options.gba);
+        gbc->init();
+    } catch(std::exception& e) {
+        gbc.reset();
+        std::lock_guard<std::mutex> lock(this->console_mtx);
+        std::cout << "[" << device->port_url << "] error: " << e.what() << std::endl;
+    }
+
+    std::unique_lock<std::mutex> lock(device->mtx);
+    device->ready = (bool)gbc;
+    if(!gbc) {
+        device->error = "board did not respond";
+    }
+
+    while(true) {
+        device->cv.wait(lock, [device]() { return !device->queue.empty(); });
+        current = device->queue.front();
+        device->queue.pop_front();
+        device->busy = true;
+        lock.unlock();
+
+        if(gbc) {
+            current->job.run(gbc.get(), &this->names);
+        }
+
+        std::stringstream msg;
+        if(!gbc) {
+            msg << "failed " << current->id << " " << device->error;
+        } else if(current->job.failed()) {
+            msg << "failed " << current->id << " " << current->job.get_error();
+        } else {
+            msg << "done " << current->id << " " << current->job.get_bytes() << " " << std::fixed
+                << std::setprecision(2) << current->job.get_seconds();
+            if(!current->job.get_filename().empty()) {
+                msg << " " << current->job.get_filename();
+            }
+        }
+        console.flush();
+        current->client->send(msg.str());
+        current.reset();
+
+        lock.lock();
+        device->busy = false;
+    }
+}
+
+/**
+ * @brief      handle the requests of a single client until it disconnects
+ *
+ * @param[in]  client  client connection
+ */
+void ReaderDaemon::serve_client(std::shared_ptr<DaemonClient> client) {
+    boost::asio::streambuf input;
+    boost::system::error_code ec;
+
+    while(true) {
+        boost::asio::read_until(client->get_socket(), input, '\n', ec);
+        if(ec) {
+            break;
+        }
+
+        std::istream in(&input);
+        std::string request;
+        std::getline(in, request);
+        if(!request.empty() && request.back() == '\r') {
+            request.pop_back();
+        }
+        if(!request.empty()) {
+            this->handle_request(request, client);
+        }
+    }
+}
+
+/**
+ * @brief      handle a single request
+ *
+ * @param[in]  request  request line
+ * @param[in]  client   client connection
+ */
+void ReaderDaemon::handle_request(const std::string& request, const std::shared_ptr<DaemonClient>& client) {
+    std::istringstream in(request);
+    std::string command, port_url, file;
+    in >> command >> port_url;
+    std::getline(in >> std::ws, file);
+
+    if(command == "status") {
+        for(auto& device : this->devices) {
+            std::lock_guard<std::mutex> lock(device->mtx);
+            std::stringstream msg;
+            msg << "device " << device->port_url << " " << (device->ready ? "ready" : "offline") << " "
+                << device->queue.size() + (device->busy ? 1 : 0);
+            if(!device->error.empty()) {
+                msg << " " << device->error;
+            }
+            client->send(msg.str());
+        }
+        client->send("end");
+        return;
+    }
+
+    DeviceOptions job_options = this->options;
+    int type = DeviceJob::JOB_READ_ROM;
+    if(command == "rom") {
+        type = DeviceJob::JOB_READ_ROM;
+    } else if(command == "resume") {
+        type = DeviceJob::JOB_READ_ROM;
+        job_options.resume = true;
+    } else if(command == "ram") {
+        type = DeviceJob::JOB_READ_RAM;
+    } else if(command == "load") {
+        type = DeviceJob::JOB_LOAD_RAM;
+    } else if(command == "bench") {
+        type = DeviceJob::JOB_BENCHMARK;
+    } else {
+        client->send("error unknown command: " + command);
+        return;
+    }
+
+    if(file.empty() && type != DeviceJob::JOB_BENCHMARK) {
+        client->send("error missing file name");
+        return;
+    }
+
+    DaemonDevice* device = this->find_device(port_url);
+    if(device == nullptr) {
+        client->send("error unknown port: " + port_url);
+        return;
+    }
+
+    std::shared_ptr<DaemonJob> job(new DaemonJob(this->next_id++,
+        DeviceJob(device->port_url, type, file, job_options), client));
+
+    // the reply is sent before the job is queued, such that it always
+    // precedes the events of the job
+    client->send("queued " + std::to_string(job->id) + " " + device->port_url);
+    {
+        std::lock_guard<std::mutex> lock(device->mtx);
+        device->queue.push_back(job);
+    }
+    device->cv.notify_one();
+}
+
+/**
+ * @brief      find the board that belongs to a port
+ *
+ * @param[in]  port_url  path to the serial port or '*'
+ *
+ * @return     board, or nullptr when the port is unknown
+ */
+DaemonDevice* ReaderDaemon::find_device(const std::string& port_url) {
+    DaemonDevice* found = nullptr;
+    size_t shortest = 0;
+
+    for(auto& device : this->devices) {
+        if(port_url == device->port_url) {
+            return device.get();
+        }
+
+        if(port_url == "*") {
+            std::lock_guard<std::mutex> lock(device->mtx);
+            const size_t jobs = device->queue.size() + (device->busy ? 1 : 0);
+            if(device->ready && (found == nullptr || jobs < shortest)) {
+                found = device.get();
+                shortest = jobs;
+            }
+        }
+    }
+
+    return found;
+}
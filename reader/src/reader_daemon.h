@@ -0,0 +1,206 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _READER_DAEMON_H
+#define _READER_DAEMON_H
+
+#include <boost/asio.hpp>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <streambuf>
+
+#include "device_job.h"
+
+/**
+ * @brief      stream buffer that hands every completed line to a callback;
+ *             both '\n' and '\r' (used by the progress bar) end a line
+ */
+class LineStreambuf : public std::streambuf {
+private:
+    std::string line;
+    std::function<void(const std::string&)> callback;
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param[in]  _callback  receives every line
+     */
+    LineStreambuf(const std::function<void(const std::string&)>& _callback);
+
+protected:
+    int overflow(int c) override;
+};
+
+/**
+ * @brief      connection of a client to the daemon; replies and events of
+ *             jobs running on other threads are written under a lock
+ */
+class DaemonClient {
+private:
+    boost::asio::local::stream_protocol::socket socket;
+    std::mutex mtx;
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param      io    io service of the daemon
+     */
+    DaemonClient(boost::asio::io_service& io);
+
+    /**
+     * @brief      send a single line; a client that has disconnected is
+     *             silently ignored, its jobs keep running
+     *
+     * @param[in]  line  line without newline
+     */
+    void send(const std::string& line);
+
+    inline boost::asio::local::stream_protocol::socket& get_socket() {
+        return this->socket;
+    }
+};
+
+/**
+ * @brief      job submitted by a client
+ */
+struct DaemonJob {
+    unsigned int id;
+    DeviceJob job;
+    std::shared_ptr<DaemonClient> client;
+
+    DaemonJob(unsigned int _id, const DeviceJob& _job, const std::shared_ptr<DaemonClient>& _client) :
+        id(_id), job(_job), client(_client) {}
+};
+
+/**
+ * @brief      reader board that stays connected and works through its own
+ *             queue of jobs
+ */
+struct DaemonDevice {
+    std::string port_url;
+    std::deque<std::shared_ptr<DaemonJob>> queue;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool ready = false;             // board answered upon connecting
+    bool busy = false;              // a job is running
+    std::string error;              // reason the board is unavailable
+    std::thread worker;
+
+    DaemonDevice(const std::string& _port_url) : port_url(_port_url) {}
+};
+
+/**
+ * @brief      keeps the serial ports open and accepts jobs over a Unix
+ *             domain socket
+ *
+ * Every request is a single line:
+ *
+ *     rom <port> <file>       read the ROM
+ *     resume <port> <file>    resume an interrupted ROM dump
+ *     ram <port> <file>       back up the SRAM
+ *     load <port> <file>      restore the SRAM
+ *     bench <port>            measure the cycles per byte read
+ *     status                  list the boards and their queues
+ *
+ * where <port> is the path of a serial port or '*' for the board with the
+ * shortest queue, and <file> is the remainder of the line, which may
+ * contain the placeholders {title} and {port}. Replies and events:
+ *
+ *     queued <id> <port>
+ *     progress <id> <message>
+ *     done <id> <bytes> <seconds> <file>
+ *     failed <id> <reason>
+ *     device <port> <ready|offline> <jobs> [reason]
+ *     end
+ *     error <reason>
+ */
+class ReaderDaemon {
+private:
+    std::string socket_path;
+    DeviceOptions options;
+    std::vector<std::unique_ptr<DaemonDevice>> devices;
+    OutputNames names;
+    std::atomic<unsigned int> next_id;
+    std::mutex console_mtx;         // guards std::cout
+
+    boost::asio::io_service io;
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param[in]  _socket_path  path of the Unix domain socket
+     * @param[in]  ports         paths to the serial ports
+     * @param[in]  _options      settings of the boards
+     */
+    ReaderDaemon(const std::string& _socket_path, const std::vector<std::string>& ports,
+                 const DeviceOptions& _options);
+
+    /**
+     * @brief      connect to the boards and serve clients until the process
+     *             is terminated
+     */
+    void run();
+
+private:
+    /**
+     * @brief      connect to a board and run the jobs in its queue
+     *
+     * @param      device  board
+     */
+    void device_worker(DaemonDevice* device);
+
+    /**
+     * @brief      handle the requests of a single client until it
+     *             disconnects
+     *
+     * @param[in]  client  client connection
+     */
+    void serve_client(std::shared_ptr<DaemonClient> client);
+
+    /**
+     * @brief      handle a single request
+     *
+     * @param[in]  request  request line
+     * @param[in]  client   client connection
+     */
+    void handle_request(const std::string& request, const std::shared_ptr<DaemonClient>& client);
+
+    /**
+     * @brief      find the board that belongs to a port
+     *
+     * @param[in]  port_url  path to the serial port or '*'
+     *
+     * @return     board, or nullptr when the port is unknown
+     */
+    DaemonDevice* find_device(const std::string& port_url);
+};
+
+#endif
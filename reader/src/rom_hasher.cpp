@@ -0,0 +1,101 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "rom_hasher.h"
+#include "crc.h"
+
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+/**
+ * @brief      account for a range of ROM bytes
+ *
+ * @param[in]  data    pointer to the bytes of the range
+ * @param[in]  offset  offset of the range in the ROM
+ * @param[in]  len     number of bytes
+ */
+void RomHasher::update(const uint8_t* data, size_t offset, size_t len) {
+    if(offset > this->hashed || offset + len <= this->hashed) {
+        return;
+    }
+
+    const size_t skip = this->hashed - offset;
+    this->crc = crc32(data + skip, len - skip, this->crc);
+    this->md5.update(data + skip, len - skip);
+    this->sha1.update(data + skip, len - skip);
+    this->hashed += len - skip;
+}
+
+/**
+ * @brief      hash the part of the ROM that was skipped and finish
+ *
+ * @param[in]  out   output file that holds the complete ROM
+ *
+ * @return     hashes of the ROM
+ */
+RomHashes RomHasher::finish(const RomWriter& out) {
+    std::vector<uint8_t> data(0x10000);
+    while(this->hashed < out.get_size()) {
+        const size_t len = std::min(data.size(), out.get_size() - this->hashed);
+        if(!out.read(this->hashed, data.data(), len)) {
+            throw std::runtime_error("Could not read back the ROM to hash it");
+        }
+        this->update(data.data(), this->hashed, len);
+    }
+
+    RomHashes hashes;
+    hashes.size = this->hashed;
+    hashes.crc32 = this->crc;
+    hashes.md5 = this->md5.hexdigest();
+    hashes.sha1 = this->sha1.hexdigest();
+
+    return hashes;
+}
+
+/**
+ * @brief      hash a file
+ *
+ * @param[in]  path  path to the file
+ *
+ * @return     hashes of the file
+ */
+RomHashes RomHasher::hash_file(const std::string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if(!in) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    RomHasher hasher;
+    std::vector<uint8_t> data(0x10000);
+    while(in) {
+        in.read((char*)data.data(), data.size());
+        hasher.update(data.data(), hasher.hashed, in.gcount());
+    }
+
+    RomHashes hashes;
+    hashes.size = hasher.hashed;
+    hashes.crc32 = hasher.crc;
+    hashes.md5 = hasher.md5.hexdigest();
+    hashes.sha1 = hasher.sha1.hexdigest();
+
+    return hashes;
+}
@@ -0,0 +1,87 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _ROM_HASHER_H
+#define _ROM_HASHER_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "md5.h"
+#include "sha1.h"
+#include "rom_writer.h"
+
+/**
+ * @brief      hashes of a complete ROM as listed in a DAT file
+ */
+struct RomHashes {
+    size_t size = 0;
+    uint32_t crc32 = 0;
+    std::string md5;
+    std::string sha1;
+};
+
+/**
+ * @brief      calculates CRC-32, MD5 and SHA-1 of a ROM while it arrives
+ *
+ * The hashes need the data in order. Blocks that continue the stream are
+ * hashed right away; a block that arrives ahead of a gap (a frame that has
+ * to be requested again) is skipped, and finish() reads the part after the
+ * first gap back from the output file. In the common case of an undamaged
+ * transfer, the file is never read.
+ */
+class RomHasher {
+private:
+    size_t hashed = 0;              // bytes hashed so far
+    uint32_t crc = 0;
+    Md5 md5;
+    Sha1 sha1;
+
+public:
+    /**
+     * @brief      account for a range of ROM bytes
+     *
+     * @param[in]  data    pointer to the bytes of the range
+     * @param[in]  offset  offset of the range in the ROM
+     * @param[in]  len     number of bytes
+     */
+    void update(const uint8_t* data, size_t offset, size_t len);
+
+    /**
+     * @brief      hash the part of the ROM that was skipped and finish
+     *
+     * @param[in]  out   output file that holds the complete ROM
+     *
+     * @return     hashes of the ROM
+     */
+    RomHashes finish(const RomWriter& out);
+
+    /**
+     * @brief      hash a file
+     *
+     * @param[in]  path  path to the file
+     *
+     * @return     hashes of the file
+     */
+    static RomHashes hash_file(const std::string& path);
+};
+
+#endif
@@ -0,0 +1,200 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "rom_store.h"
+#include "sha256.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <mutex>
+#include <cstdio>
+#include <cerrno>
+#include <sys/stat.h>
+
+namespace {
+
+// serializes updates of the index by boards that run concurrently
+std::mutex index_mtx;
+
+void make_directory(const std::string& path) {
+    if(mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("Could not create " + path);
+    }
+}
+
+// a title is read from the cartridge header and may hold any byte, hence
+// '%' and non-printable bytes are written as %XX to keep a dump on one line
+std::string escape_title(const std::string& title) {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string escaped;
+    for(unsigned char c : title) {
+        if(c < 0x20 || c > 0x7E || c == '%') {
+            escaped += '%';
+            escaped += hex[c >> 4];
+            escaped += hex[c & 0x0F];
+        } else {
+            escaped += (char)c;
+        }
+    }
+    return escaped;
+}
+
+}
+
+/**
+ * @brief      default constructor; creates the store when needed
+ *
+ * @param[in]  _dir  directory of the store
+ */
+RomStore::RomStore(const std::string& _dir) :
+    dir(_dir) {
+    make_directory(this->dir);
+    make_directory(this->dir + "/objects");
+}
+
+/**
+ * @brief      path of the index
+ */
+std::string RomStore::index_path() const {
+    return this->dir + "/index";
+}
+
+/**
+ * @brief      path of a dump in the store
+ *
+ * @param[in]  sha   SHA-256 of the dump
+ */
+std::string RomStore::object_path(const std::string& sha) const {
+    return this->dir + "/objects/" + sha;
+}
+
+/**
+ * @brief      find the dump of a cartridge
+ *
+ * @param[in]  title            title from the cartridge header
+ * @param[in]  header_checksum  header checksum (0x14D)
+ * @param[in]  global_checksum  global checksum (0x14E-0x14F)
+ * @param[out] sha              SHA-256 of the dump
+ * @param[out] size             size of the dump
+ *
+ * @return     whether the store holds a dump with this fingerprint
+ */
+bool RomStore::lookup(const std::string& title, uint8_t header_checksum, uint16_t global_checksum,
+                      std::string* sha, size_t* size) const {
+    std::lock_guard<std::mutex> lock(index_mtx);
+    std::ifstream in(this->index_path().c_str());
+
+    bool found = false;
+    std::string line;
+    while(std::getline(in, line)) {
+        std::istringstream fields(line);
+        unsigned int i_header_checksum = 0, i_global_checksum = 0;
+        size_t i_size = 0;
+        std::string i_sha, i_title;
+        fields >> std::hex >> i_header_checksum >> i_global_checksum >> std::dec >> i_size >> i_sha;
+        if(fields.fail()) {
+            continue;
+        }
+
+        // the title follows a single space and may be empty
+        fields.get();
+        std::getline(fields, i_title);
+        if(i_header_checksum == header_checksum && i_global_checksum == global_checksum &&
+           i_title == escape_title(title)) {
+            *sha = i_sha;
+            *size = i_size;
+            found = true;
+        }
+    }
+
+    // an object that was removed by hand is no hit
+    struct stat st;
+    return found && stat(this->object_path(*sha).c_str(), &st) == 0 && (size_t)st.st_size == *size;
+}
+
+/**
+ * @brief      add a dump to the store
+ *
+ * @param[in]  path             path to the dump
+ * @param[in]  title            title from the cartridge header
+ * @param[in]  header_checksum  header checksum (0x14D)
+ * @param[in]  global_checksum  global checksum (0x14E-0x14F)
+ *
+ * @return     SHA-256 of the dump
+ */
+std::string RomStore::add(const std::string& path, const std::string& title, uint8_t header_checksum,
+                          uint16_t global_checksum) {
+    const std::string sha = sha256_file(path);
+    const std::string object = this->object_path(sha);
+
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    std::lock_guard<std::mutex> lock(index_mtx);
+
+    // the contents determine the name, so an existing object is identical;
+    // the copy is renamed into place so that an object is always complete
+    struct stat st_object;
+    if(stat(object.c_str(), &st_object) != 0) {
+        const std::string tmp = object + ".tmp";
+        {
+            std::ifstream src(path.c_str(), std::ios::binary);
+            std::ofstream dst(tmp.c_str(), std::ios::binary | std::ios::trunc);
+            dst << src.rdbuf();
+            if(!dst) {
+                throw std::runtime_error("Could not write " + tmp);
+            }
+        }
+        if(std::rename(tmp.c_str(), object.c_str()) != 0) {
+            throw std::runtime_error("Could not write " + object);
+        }
+    }
+
+    std::ofstream index(this->index_path().c_str(), std::ios::app);
+    index << std::hex << std::setfill('0') << std::setw(2) << (unsigned int)header_checksum << " "
+          << std::setw(4) << global_checksum << " " << std::dec << st.st_size << " " << sha << " "
+          << escape_title(title) << std::endl;
+    if(!index) {
+        throw std::runtime_error("Could not write " + this->index_path());
+    }
+
+    return sha;
+}
+
+/**
+ * @brief      copy a dump out of the store
+ *
+ * @param[in]  sha   SHA-256 of the dump
+ * @param[in]  path  destination
+ */
+void RomStore::retrieve(const std::string& sha, const std::string& path) const {
+    // a copy rather than a hard link: a later dump to the same path
+    // truncates the file in place, which would destroy the stored object
+    std::ifstream src(this->object_path(sha).c_str(), std::ios::binary);
+    std::ofstream dst(path.c_str(), std::ios::binary | std::ios::trunc);
+    dst << src.rdbuf();
+    if(!src || !dst) {
+        throw std::runtime_error("Could not copy " + this->object_path(sha) + " to " + path);
+    }
+}
@@ -0,0 +1,101 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _ROM_STORE_H
+#define _ROM_STORE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      local store of ROM dumps, kept under their SHA-256
+ *
+ * Dumps are stored as <dir>/objects/<sha256>. The file <dir>/index links
+ * the fingerprint of a cartridge header to a dump, one line per dump:
+ *
+ *     <header checksum> <global checksum> <size> <sha256> <title>
+ *
+ * The title is written as-is, except for '%' and bytes outside the printable
+ * ASCII range, which are written as %XX; a title may be empty.
+ *
+ * When a fingerprint occurs more than once, the last line applies.
+ */
+class RomStore {
+private:
+    std::string dir;
+
+    /**
+     * @brief      path of the index
+     */
+    std::string index_path() const;
+
+public:
+    /**
+     * @brief      default constructor; creates the store when needed
+     *
+     * @param[in]  _dir  directory of the store
+     */
+    RomStore(const std::string& _dir);
+
+    /**
+     * @brief      find the dump of a cartridge
+     *
+     * @param[in]  title            title from the cartridge header
+     * @param[in]  header_checksum  header checksum (0x14D)
+     * @param[in]  global_checksum  global checksum (0x14E-0x14F)
+     * @param[out] sha              SHA-256 of the dump
+     * @param[out] size             size of the dump
+     *
+     * @return     whether the store holds a dump with this fingerprint
+     */
+    bool lookup(const std::string& title, uint8_t header_checksum, uint16_t global_checksum,
+                std::string* sha, size_t* size) const;
+
+    /**
+     * @brief      add a dump to the store
+     *
+     * @param[in]  path             path to the dump
+     * @param[in]  title            title from the cartridge header
+     * @param[in]  header_checksum  header checksum (0x14D)
+     * @param[in]  global_checksum  global checksum (0x14E-0x14F)
+     *
+     * @return     SHA-256 of the dump
+     */
+    std::string add(const std::string& path, const std::string& title, uint8_t header_checksum,
+                    uint16_t global_checksum);
+
+    /**
+     * @brief      copy a dump out of the store
+     *
+     * @param[in]  sha   SHA-256 of the dump
+     * @param[in]  path  destination
+     */
+    void retrieve(const std::string& sha, const std::string& path) const;
+
+    /**
+     * @brief      path of a dump in the store
+     *
+     * @param[in]  sha   SHA-256 of the dump
+     */
+    std::string object_path(const std::string& sha) const;
+};
+
+#endif
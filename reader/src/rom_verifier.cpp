@@ -0,0 +1,202 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "rom_verifier.h"
+
+#include <sstream>
+#include <iomanip>
+
+/**
+ * @brief      mix the bits of a value (splitmix64 finalizer)
+ *
+ * @param[in]  x     value
+ *
+ * @return     hash
+ */
+static uint64_t mix64(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief      default constructor
+ *
+ * @param[in]  banks  number of 16 KB banks in the ROM
+ */
+RomVerifier::RomVerifier(size_t banks) :
+    bank_value(banks, BANK_EMPTY),
+    bank_retried(banks, false),
+    bank_hash(banks, 0) {}
+
+/**
+ * @brief      account for a range of ROM bytes
+ *
+ * @param[in]  data    pointer to the bytes of the range
+ * @param[in]  offset  offset of the range in the ROM
+ * @param[in]  len     number of bytes
+ */
+void RomVerifier::update(const uint8_t* data, size_t offset, size_t len) {
+    this->hasher.update(data, offset, len);
+
+    for(size_t i=0; i<len; i++) {
+        const size_t addr = offset + i;
+
+        if(addr >= 0x134 && addr <= 0x14C) {
+            this->header_sum = this->header_sum - data[i] - 1;
+        }
+
+        switch(addr) {
+            case 0x14D:
+                this->header_checksum = data[i];
+                this->global_sum += data[i];
+            break;
+            case 0x14E:
+                this->global_checksum = (this->global_checksum & 0x00FF) | (data[i] << 8);
+            break;
+            case 0x14F:
+                this->global_checksum = (this->global_checksum & 0xFF00) | data[i];
+            break;
+            default:
+                this->global_sum += data[i];
+            break;
+        }
+
+        const size_t bank = addr / this->BANK_SIZE;
+        if(bank >= this->bank_value.size()) {
+            continue;
+        }
+
+        // a sum does not depend on the order in which the bytes arrive
+        this->bank_hash[bank] += mix64(((addr % this->BANK_SIZE) << 8) | data[i]);
+
+        if(this->bank_value[bank] != BANK_MIXED) {
+            if(this->bank_value[bank] == BANK_EMPTY) {
+                this->bank_value[bank] = data[i];
+            } else if(this->bank_value[bank] != data[i]) {
+                this->bank_value[bank] = BANK_MIXED;
+            }
+        }
+    }
+}
+
+/**
+ * @brief      record that (part of) a bank had to be transferred again
+ *
+ * @param[in]  bank  bank number
+ */
+void RomVerifier::mark_retried(size_t bank) {
+    if(bank < this->bank_retried.size()) {
+        this->bank_retried[bank] = true;
+    }
+}
+
+/**
+ * @brief      banks that are likely damaged, in ascending order
+ */
+std::vector<size_t> RomVerifier::suspect_banks() const {
+    std::vector<size_t> banks;
+
+    for(size_t i=0; i<this->bank_value.size(); i++) {
+        if((i == 0 && !this->header_valid()) || this->mirror_of(i) >= 0 || this->bank_value[i] >= 0 ||
+           this->bank_retried[i]) {
+            banks.push_back(i);
+        }
+    }
+
+    return banks;
+}
+
+/**
+ * @brief      report of both checksums and, on a mismatch, the suspect banks
+ */
+std::string RomVerifier::report() const {
+    std::stringstream msg;
+    msg << std::hex << std::uppercase << std::setfill('0');
+
+    msg << "Header checksum: 0x" << std::setw(2) << (unsigned int)this->header_sum;
+    if(this->header_valid()) {
+        msg << " OK" << std::endl;
+    } else {
+        msg << " MISMATCH (header: 0x" << std::setw(2) << (unsigned int)this->header_checksum << ")" << std::endl;
+    }
+
+    msg << "Global checksum: 0x" << std::setw(4) << this->global_sum;
+    if(this->global_valid()) {
+        msg << " OK";
+    } else {
+        msg << " MISMATCH (header: 0x" << std::setw(4) << this->global_checksum << ")";
+    }
+
+    if(this->header_valid() && this->global_valid()) {
+        return msg.str();
+    }
+
+    msg << std::dec << std::endl;
+    const std::vector<size_t> suspects = this->suspect_banks();
+    if(suspects.empty()) {
+        msg << "No suspect banks found";
+        return msg.str();
+    }
+
+    msg << "Suspect banks:";
+    for(size_t bank : suspects) {
+        msg << std::endl << "  ROM BANK " << bank << ":";
+        if(bank == 0 && !this->header_valid()) {
+            msg << " header checksum mismatch";
+        }
+        const long mirror = this->mirror_of(bank);
+        if(mirror >= 0) {
+            msg << " same contents as ROM BANK " << mirror;
+        }
+        if(this->bank_value[bank] >= 0) {
+            msg << " every byte is 0x" << std::hex << std::setw(2) << this->bank_value[bank] << std::dec
+                << " (may be padding)";
+        }
+        if(this->bank_retried[bank]) {
+            msg << " needed retransmissions";
+        }
+    }
+
+    return msg.str();
+}
+
+/**
+ * @brief      another bank with the same contents
+ *
+ * @param[in]  bank  bank number
+ *
+ * @return     bank number or -1 when the contents of the bank are unique (or
+ *             the bank holds a single value)
+ */
+long RomVerifier::mirror_of(size_t bank) const {
+    // banks of uniform padding are alike by nature
+    if(this->bank_value[bank] != BANK_MIXED) {
+        return -1;
+    }
+
+    for(size_t i=0; i<this->bank_hash.size(); i++) {
+        if(i != bank && this->bank_value[i] == BANK_MIXED && this->bank_hash[i] == this->bank_hash[bank]) {
+            return i;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,146 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _ROM_VERIFIER_H
+#define _ROM_VERIFIER_H
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+#include "rom_hasher.h"
+
+/**
+ * @brief      thrown when a dump is complete, but does not match the
+ *             checksums in its header
+ */
+class ChecksumError : public std::runtime_error {
+public:
+    ChecksumError(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+/**
+ * @brief      verifies the header checksum (0x14D) and global checksum
+ *             (0x14E-0x14F) of a ROM while it is being dumped
+ *
+ * Both checksums are sums, hence every byte only has to be passed once, in
+ * any order, as soon as it arrives. To point out the banks that are likely
+ * damaged, every bank gets an order independent hash of its contents, such
+ * that a bank that holds the same data as another bank (the result of a
+ * bank switch that failed) is found. Banks that needed retransmissions and
+ * banks that hold a single value (padding, or a cartridge that lost contact)
+ * are tracked as well.
+ * The same bytes are hashed for a lookup in a DAT file.
+ */
+class RomVerifier {
+private:
+    const size_t BANK_SIZE = 0x4000;
+
+    enum {
+        BANK_EMPTY = -1,            // no data of the bank has been seen
+        BANK_MIXED = -2,            // bank holds more than a single value
+    };
+
+    uint8_t header_sum = 0;         // running header checksum over 0x134-0x14C
+    uint16_t global_sum = 0;        // sum of all bytes except 0x14E-0x14F
+    uint8_t header_checksum = 0;    // 0x14D as dumped
+    uint16_t global_checksum = 0;   // 0x14E-0x14F as dumped
+
+    std::vector<int> bank_value;    // value of a uniform bank or BANK_*
+    std::vector<bool> bank_retried; // bank needed retransmissions
+    std::vector<uint64_t> bank_hash; // sum of the hashes of (position, value)
+
+    RomHasher hasher;               // CRC-32, MD5 and SHA-1 of the ROM
+
+public:
+    /**
+     * @brief      default constructor
+     *
+     * @param[in]  banks  number of 16 KB banks in the ROM
+     */
+    RomVerifier(size_t banks);
+
+    /**
+     * @brief      account for a range of ROM bytes
+     *
+     * @param[in]  data    pointer to the bytes of the range
+     * @param[in]  offset  offset of the range in the ROM
+     * @param[in]  len     number of bytes
+     */
+    void update(const uint8_t* data, size_t offset, size_t len);
+
+    /**
+     * @brief      record that (part of) a bank had to be transferred again
+     *
+     * @param[in]  bank  bank number
+     */
+    void mark_retried(size_t bank);
+
+    /**
+     * @brief      whether the header checksum matches
+     */
+    inline bool header_valid() const {
+        return this->header_sum == this->header_checksum;
+    }
+
+    /**
+     * @brief      whether the global checksum matches
+     */
+    inline bool global_valid() const {
+        return this->global_sum == this->global_checksum;
+    }
+
+    /**
+     * @brief      finish the hashes of the ROM
+     *
+     * @param[in]  out   output file that holds the complete ROM
+     *
+     * @return     hashes of the ROM
+     */
+    inline RomHashes finish_hashes(const RomWriter& out) {
+        return this->hasher.finish(out);
+    }
+
+    /**
+     * @brief      banks that are likely damaged, in ascending order
+     */
+    std::vector<size_t> suspect_banks() const;
+
+    /**
+     * @brief      report of both checksums and, on a mismatch, the suspect
+     *             banks
+     */
+    std::string report() const;
+
+private:
+    /**
+     * @brief      another bank with the same contents
+     *
+     * @param[in]  bank  bank number
+     *
+     * @return     bank number or -1 when the contents of the bank are unique
+     *             (or the bank holds a single value)
+     */
+    long mirror_of(size_t bank) const;
+};
+
+#endif
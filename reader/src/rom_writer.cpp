@@ -0,0 +1,122 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "rom_writer.h"
+
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief      create (or truncate) the output file and preallocate it
+ *
+ * @param[in]  _path  path to the output file
+ * @param[in]  _size  size of the image
+ * @param[in]  keep   keep the contents of an existing file
+ */
+RomWriter::RomWriter(const std::string& _path, size_t _size, bool keep) :
+    size(_size),
+    path(_path) {
+
+    this->fd = open(this->path.c_str(), O_RDWR | O_CREAT | (keep ? 0 : O_TRUNC), 0644);
+    if(this->fd < 0) {
+        throw std::runtime_error("Could not open " + this->path + ": " + strerror(errno));
+    }
+
+    // reserve the blocks up front; file systems without support for
+    // preallocation still get a file of the right size
+    int ret = posix_fallocate(this->fd, 0, this->size);
+    if(ret != 0 && ftruncate(this->fd, this->size) != 0) {
+        close(this->fd);
+        throw std::runtime_error("Could not allocate " + this->path + ": " + strerror(ret));
+    }
+}
+
+/**
+ * @brief      write a block at its final offset
+ *
+ * @param[in]  offset  offset in the image
+ * @param[in]  data    pointer to data
+ * @param[in]  len     number of bytes
+ */
+void RomWriter::write(size_t offset, const uint8_t* data, size_t len) {
+    if(offset + len > this->size) {
+        throw std::runtime_error("Block exceeds the size of " + this->path);
+    }
+
+    while(len > 0) {
+        const ssize_t n = pwrite(this->fd, data, len, offset);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Could not write to " + this->path + ": " + strerror(errno));
+        }
+        data += n;
+        offset += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief      read back a block from the file
+ *
+ * @param[in]  offset  offset in the image
+ * @param      data    pointer to output buffer
+ * @param[in]  len     number of bytes
+ *
+ * @return     whether all bytes could be read
+ */
+bool RomWriter::read(size_t offset, uint8_t* data, size_t len) const {
+    while(len > 0) {
+        const ssize_t n = pread(this->fd, data, len, offset);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return false;
+        }
+        data += n;
+        offset += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      flush all written blocks to the disk
+ */
+void RomWriter::sync() {
+    if(fdatasync(this->fd) != 0) {
+        throw std::runtime_error("Could not write to " + this->path + ": " + strerror(errno));
+    }
+}
+
+/**
+ * @brief      Destroys the object.
+ */
+RomWriter::~RomWriter() {
+    if(this->fd >= 0) {
+        close(this->fd);
+    }
+}
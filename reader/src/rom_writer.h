@@ -0,0 +1,94 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _ROM_WRITER_H
+#define _ROM_WRITER_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief      writes an image to a file that is preallocated to its final
+ *             size, placing every block directly at its offset
+ *
+ * Blocks may arrive in any order and are on disk as soon as write() returns,
+ * such that an interrupted transfer leaves a file of the correct size in
+ * which every received block is at its final position.
+ */
+class RomWriter {
+private:
+    int fd = -1;
+    size_t size;
+    std::string path;
+
+public:
+    /**
+     * @brief      create (or truncate) the output file and preallocate it
+     *
+     * @param[in]  _path  path to the output file
+     * @param[in]  _size  size of the image
+     * @param[in]  keep   keep the contents of an existing file
+     */
+    RomWriter(const std::string& _path, size_t _size, bool keep = false);
+
+    /**
+     * @brief      write a block at its final offset
+     *
+     * @param[in]  offset  offset in the image
+     * @param[in]  data    pointer to data
+     * @param[in]  len     number of bytes
+     */
+    void write(size_t offset, const uint8_t* data, size_t len);
+
+    /**
+     * @brief      read back a block from the file
+     *
+     * @param[in]  offset  offset in the image
+     * @param      data    pointer to output buffer
+     * @param[in]  len     number of bytes
+     *
+     * @return     whether all bytes could be read
+     */
+    bool read(size_t offset, uint8_t* data, size_t len) const;
+
+    /**
+     * @brief      flush all written blocks to the disk
+     */
+    void sync();
+
+    /**
+     * @brief      size of the image
+     */
+    inline size_t get_size() const {
+        return this->size;
+    }
+
+    /**
+     * @brief      Destroys the object.
+     */
+    ~RomWriter();
+
+private:
+    RomWriter(RomWriter const&)        = delete;
+    void operator=(RomWriter const&)   = delete;
+};
+
+#endif
@@ -0,0 +1,144 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "sha1.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+inline uint32_t rotl(uint32_t x, unsigned int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+}
+
+/**
+ * @brief      default constructor
+ */
+Sha1::Sha1() :
+    state{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0} {}
+
+/**
+ * @brief      process a single 64 byte block
+ *
+ * @param[in]  data  pointer to block
+ */
+void Sha1::transform(const uint8_t* data) {
+    uint32_t w[80];
+    for(unsigned int i=0; i<16; i++) {
+        w[i] = ((uint32_t)data[4*i] << 24) | ((uint32_t)data[4*i+1] << 16) |
+               ((uint32_t)data[4*i+2] << 8) | data[4*i+3];
+    }
+    for(unsigned int i=16; i<80; i++) {
+        w[i] = rotl(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    }
+
+    uint32_t a = this->state[0], b = this->state[1], c = this->state[2], d = this->state[3];
+    uint32_t e = this->state[4];
+    for(unsigned int i=0; i<80; i++) {
+        uint32_t f, k;
+        if(i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if(i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if(i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+
+        const uint32_t t = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = t;
+    }
+
+    this->state[0] += a;
+    this->state[1] += b;
+    this->state[2] += c;
+    this->state[3] += d;
+    this->state[4] += e;
+}
+
+/**
+ * @brief      hash data
+ *
+ * @param[in]  data  pointer to data
+ * @param[in]  len   number of bytes
+ */
+void Sha1::update(const uint8_t* data, size_t len) {
+    this->total_len += len;
+
+    // complete a partially filled block first
+    if(this->block_len > 0) {
+        const size_t n = std::min(len, sizeof(this->block) - this->block_len);
+        memcpy(this->block + this->block_len, data, n);
+        this->block_len += n;
+        data += n;
+        len -= n;
+        if(this->block_len < sizeof(this->block)) {
+            return;
+        }
+        this->transform(this->block);
+        this->block_len = 0;
+    }
+
+    for(; len >= sizeof(this->block); data += sizeof(this->block), len -= sizeof(this->block)) {
+        this->transform(data);
+    }
+
+    memcpy(this->block, data, len);
+    this->block_len = len;
+}
+
+/**
+ * @brief      finish the hash
+ *
+ * @return     digest as 40 lower case hex characters
+ */
+std::string Sha1::hexdigest() {
+    const uint64_t bits = this->total_len * 8;
+
+    // pad with 0x80, zeros and the message length in bits
+    uint8_t padding[72] = {0x80};
+    const size_t pad_len = (this->block_len < 56 ? 56 : 120) - this->block_len;
+    for(unsigned int i=0; i<8; i++) {
+        padding[pad_len + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    this->update(padding, pad_len + 8);
+
+    static const char digits[] = "0123456789abcdef";
+    std::string digest;
+    for(unsigned int i=0; i<5; i++) {
+        for(int j=28; j>=0; j-=4) {
+            digest += digits[(this->state[i] >> j) & 0x0F];
+        }
+    }
+
+    return digest;
+}
@@ -0,0 +1,175 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#include "sha256.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t rotr(uint32_t x, unsigned int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+}
+
+/**
+ * @brief      default constructor
+ */
+Sha256::Sha256() :
+    state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {}
+
+/**
+ * @brief      process a single 64 byte block
+ *
+ * @param[in]  data  pointer to block
+ */
+void Sha256::transform(const uint8_t* data) {
+    uint32_t w[64];
+    for(unsigned int i=0; i<16; i++) {
+        w[i] = ((uint32_t)data[4*i] << 24) | ((uint32_t)data[4*i+1] << 16) |
+               ((uint32_t)data[4*i+2] << 8) | data[4*i+3];
+    }
+    for(unsigned int i=16; i<64; i++) {
+        const uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+        const uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+
+    uint32_t a = this->state[0], b = this->state[1], c = this->state[2], d = this->state[3];
+    uint32_t e = this->state[4], f = this->state[5], g = this->state[6], h = this->state[7];
+    for(unsigned int i=0; i<64; i++) {
+        const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+        const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    this->state[0] += a;
+    this->state[1] += b;
+    this->state[2] += c;
+    this->state[3] += d;
+    this->state[4] += e;
+    this->state[5] += f;
+    this->state[6] += g;
+    this->state[7] += h;
+}
+
+/**
+ * @brief      hash data
+ *
+ * @param[in]  data  pointer to data
+ * @param[in]  len   number of bytes
+ */
+void Sha256::update(const uint8_t* data, size_t len) {
+    this->total_len += len;
+
+    // complete a partially filled block first
+    if(this->block_len > 0) {
+        const size_t n = std::min(len, sizeof(this->block) - this->block_len);
+        memcpy(this->block + this->block_len, data, n);
+        this->block_len += n;
+        data += n;
+        len -= n;
+        if(this->block_len < sizeof(this->block)) {
+            return;
+        }
+        this->transform(this->block);
+        this->block_len = 0;
+    }
+
+    for(; len >= sizeof(this->block); data += sizeof(this->block), len -= sizeof(this->block)) {
+        this->transform(data);
+    }
+
+    memcpy(this->block, data, len);
+    this->block_len = len;
+}
+
+/**
+ * @brief      finish the hash
+ *
+ * @return     digest as 64 lower case hex characters
+ */
+std::string Sha256::hexdigest() {
+    const uint64_t bits = this->total_len * 8;
+
+    // pad with 0x80, zeros and the message length in bits
+    uint8_t padding[72] = {0x80};
+    const size_t pad_len = (this->block_len < 56 ? 56 : 120) - this->block_len;
+    for(unsigned int i=0; i<8; i++) {
+        padding[pad_len + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    this->update(padding, pad_len + 8);
+
+    static const char digits[] = "0123456789abcdef";
+    std::string digest;
+    for(unsigned int i=0; i<8; i++) {
+        for(int j=28; j>=0; j-=4) {
+            digest += digits[(this->state[i] >> j) & 0x0F];
+        }
+    }
+
+    return digest;
+}
+
+/**
+ * @brief      calculate the SHA-256 of a file
+ *
+ * @param[in]  path  path to the file
+ *
+ * @return     digest as 64 lower case hex characters
+ */
+std::string sha256_file(const std::string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if(!in) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    Sha256 sha;
+    std::vector<uint8_t> buffer(0x10000);
+    while(in) {
+        in.read((char*)buffer.data(), buffer.size());
+        sha.update(buffer.data(), in.gcount());
+    }
+
+    return sha.hexdigest();
+}
@@ -0,0 +1,160 @@
+/**************************************************************************
+ *   This file is part of GBCR.                                           *
+ *                                                                        *
+ *   Copyright (C) 2017, Ivo Filot                                        *
+ *                                                                        *
+ *   GBCR is free software: you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published    *
+ *   by the Free Software Foundation, either version 3 of the License,    *
+ *   or (at your option) any later version.                               *
+ *                                                                        *
+ *   GBCR is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty          *
+ *   of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.              *
+ *   See the GNU General Public License for more details.                 *
+ *                                                                        *
+ *   You should have received a copy of the GNU General Public License    *
+ *   along with this program.  If not, see http://www.gnu.org/licenses/.  *
+ *                                                                        *
+ **************************************************************************/
+
+#ifndef _SPSC_RING_H
+#define _SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/**
+ * @brief      lock-free ring buffer for a single producer and a single
+ *             consumer thread
+ *
+ * Slots are filled and drained in place: the producer obtains a free slot
+ * with acquire(), fills it and hands it over with publish(); the consumer
+ * obtains the oldest slot with peek() and returns it with release(). Both
+ * acquire() and peek() return nullptr instead of blocking, such that the
+ * calling stage decides how to wait. Every wait that starts is counted as
+ * a stall, which together with the occupancy upon publishing shows which
+ * side of the ring limits the throughput.
+ *
+ * @tparam     T     slot type
+ * @tparam     N     number of slots (power of two)
+ */
+template<class T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "number of slots must be a power of two");
+
+private:
+    std::vector<T> slots;
+
+    alignas(64) std::atomic<size_t> head;   // next slot to publish (producer)
+    alignas(64) std::atomic<size_t> tail;   // next slot to release (consumer)
+
+    // statistics of the producer
+    alignas(64) size_t producer_stalls = 0;
+    bool producer_waiting = false;
+    size_t published = 0;
+    size_t occupancy_sum = 0;
+    size_t occupancy_max = 0;
+
+    // statistics of the consumer
+    alignas(64) size_t consumer_stalls = 0;
+    bool consumer_waiting = false;
+
+public:
+    SpscRing() : slots(N), head(0), tail(0) {}
+
+    /**
+     * @brief      obtain a free slot for the producer
+     *
+     * @return     pointer to slot or nullptr when the ring is full
+     */
+    T* acquire() {
+        const size_t h = this->head.load(std::memory_order_relaxed);
+        if(h - this->tail.load(std::memory_order_acquire) == N) {
+            if(!this->producer_waiting) {
+                this->producer_stalls++;
+                this->producer_waiting = true;
+            }
+            return nullptr;
+        }
+
+        this->producer_waiting = false;
+        return &this->slots[h & (N - 1)];
+    }
+
+    /**
+     * @brief      hand the slot obtained by acquire() over to the consumer
+     */
+    void publish() {
+        const size_t h = this->head.load(std::memory_order_relaxed);
+        const size_t occupancy = h + 1 - this->tail.load(std::memory_order_relaxed);
+        this->published++;
+        this->occupancy_sum += occupancy;
+        this->occupancy_max = std::max(this->occupancy_max, occupancy);
+        this->head.store(h + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief      obtain the oldest published slot for the consumer
+     *
+     * @return     pointer to slot or nullptr when the ring is empty
+     */
+    T* peek() {
+        const size_t t = this->tail.load(std::memory_order_relaxed);
+        if(this->head.load(std::memory_order_acquire) == t) {
+            if(!this->consumer_waiting) {
+                this->consumer_stalls++;
+                this->consumer_waiting = true;
+            }
+            return nullptr;
+        }
+
+        this->consumer_waiting = false;
+        return &this->slots[t & (N - 1)];
+    }
+
+    /**
+     * @brief      return the slot obtained by peek() to the producer
+     */
+    void release() {
+        this->tail.store(this->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief      number of slots
+     */
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    /**
+     * @brief      number of times the producer had to wait for a free slot
+     */
+    size_t get_producer_stalls() const {
+        return this->producer_stalls;
+    }
+
+    /**
+     * @brief      number of times the consumer had to wait for a slot
+     */
+    size_t get_consumer_stalls() const {
+        return this->consumer_stalls;
+    }
+
+    /**
+     * @brief      average number of occupied slots upon publishing
+     */
+    double get_average_occupancy() const {
+        return this->published > 0 ? (double)this->occupancy_sum / this->published : 0.0;
+    }
+
+    /**
+     * @brief      highest number of occupied slots
+     */
+    size_t get_max_occupancy() const {
+        return this->occupancy_max;
+    }
+};
+
+#endif